@@ -0,0 +1,238 @@
+#include "AccidentFilter.h"
+#include <algorithm>
+#include "ScanKernels.h"
+#include "Parallel.h"
+
+// Bitmap words (64 rows each) in a morsel of the parallel column scans, one zone of the store
+constexpr size_t SCAN_MORSEL_WORDS = ZoneMap::ROWS / 64;
+
+// Largest share of the rows a distance range can keep and still be answered from the sorted
+// distance index rather than a scan of the distance column
+constexpr double DISTANCE_INDEX_LIMIT = 1.0 / 32;
+
+// Share of the rows an equality on each field keeps in the 100k accident extract: severity is
+// skewed (2 covers 80% of the rows), there are 50 states, ~6.4k cities and ~37k zipcodes
+static double severitySelectivity(int severity) {
+    switch (severity) {
+        case 1: return 0.0085;
+        case 2: return 0.80;
+        case 3: return 0.17;
+        case 4: return 0.026;
+        default: return 0.0;
+    }
+}
+
+// Keep only the records with the given severity
+void AccidentFilter::requireSeverity(int severity) {
+    predicates.push_back({SEVERITY, severity, "", 0, 0, 0, severitySelectivity(severity), ZipIndex::NO_KEY, ZipIndex::NO_KEY, {}});
+}
+
+// Keep only the records in the given city, ignoring case, or in any city starting with the text
+// before a trailing *
+void AccidentFilter::requireCity(const std::string& city) {
+    predicates.push_back({CITY, 0, city, 0, 0, 0, 1.0 / 6400, ZipIndex::NO_KEY, ZipIndex::NO_KEY, {}});
+}
+
+// Keep only the records in the given state
+void AccidentFilter::requireState(const std::string& state) {
+    predicates.push_back({STATE, 0, state, 0, 0, 0, 1.0 / 50, ZipIndex::NO_KEY, ZipIndex::NO_KEY, {}});
+}
+
+// Keep only the records with the given zipcode
+void AccidentFilter::requireZipcode(const std::string& zipcode) {
+    predicates.push_back({ZIPCODE, 0, zipcode, 0, 0, 0, 1.0 / 37000, ZipIndex::NO_KEY, ZipIndex::NO_KEY, {}});
+}
+
+// Keep only the records with a distance between low and high, both included. Without statistics
+// a range is taken to keep a third of the rows
+void AccidentFilter::requireDistance(double low, double high) {
+    predicates.push_back({DISTANCE, 0, "", 0, low, high, 1.0 / 3, ZipIndex::NO_KEY, ZipIndex::NO_KEY, {}});
+}
+
+// Resolve the strings to the dictionary codes of the store, a string no row uses can never match,
+// and replace the fixed selectivities with the statistics of the store where it has them: the
+// bitmap indexes give the exact share of a severity or a state and the posting lists of the city
+// index that of the cities, the zipcode index counts a numeric zipcode exactly (any other zipcode
+// is taken to be as common as the average one), and a distance range is estimated from the
+// histogram of the distance index. Then order the predicates so the one that rejects the most
+// records is checked first
+void AccidentFilter::compile(const RecordStore& store) {
+    satisfiable = true;
+    double rows = store.size() > 0 ? static_cast<double>(store.size()) : 1.0;
+    for (auto& predicate : predicates) {
+        if (predicate.field == SEVERITY) {
+            const RoaringBitmap* indexed = store.severityBitmaps().rows(static_cast<uint32_t>(predicate.severity));
+            if (store.size() > 0 && predicate.severity >= 0) {
+                predicate.selectivity = indexed == nullptr ? 0.0 : indexed->cardinality() / rows;
+            }
+            continue;
+        } else if (predicate.field == CITY) {
+            //the city trie resolves the name to the codes of its spellings, or of every city with the prefix
+            const CityIndex& names = store.cityNames();
+            bool isPrefix = !predicate.value.empty() && predicate.value.back() == '*';
+            predicate.codes = isPrefix ? names.prefix(predicate.value.substr(0, predicate.value.size() - 1))
+                                       : names.exact(predicate.value);
+            std::sort(predicate.codes.begin(), predicate.codes.end());
+            predicate.selectivity = names.rowCount(predicate.codes) / rows;
+            if (predicate.codes.empty()) {
+                satisfiable = false;
+            }
+            continue;
+        } else if (predicate.field == STATE) {
+            predicate.code = store.states().lookup(predicate.value);
+            if (predicate.code != StringDictionary::NOT_FOUND) {
+                predicate.selectivity = store.stateBitmaps().rows(predicate.code)->cardinality() / rows;
+            }
+        } else if (predicate.field == ZIPCODE) {
+            predicate.code = store.zipcodes().lookup(predicate.value);
+            predicate.selectivity = 1.0 / std::max<size_t>(store.zipcodes().size(), 1);
+            //a numeric zipcode is matched on its key range, the index counts its rows exactly
+            if (ZipIndex::range(predicate.value, predicate.keyLow, predicate.keyHigh)) {
+                size_t matching = store.sortedZipcodes().countBetween(predicate.keyLow, predicate.keyHigh);
+                predicate.selectivity = matching / rows;
+                if (matching == 0) {
+                    satisfiable = false;
+                }
+                continue;
+            }
+        } else {
+            if (store.size() > 0) {
+                predicate.selectivity = store.sortedDistances().estimateBetween(predicate.low, predicate.high);
+            }
+            continue;
+        }
+        if (predicate.code == StringDictionary::NOT_FOUND) {
+            satisfiable = false;
+            predicate.selectivity = 0.0;
+        }
+    }
+    std::stable_sort(predicates.begin(), predicates.end(), [](const Predicate& a, const Predicate& b) {
+        return a.selectivity < b.selectivity;
+    });
+}
+
+// True when select() answers the predicate from the distance index instead of a column scan
+bool AccidentFilter::usesDistanceIndex(const Predicate& predicate) {
+    return predicate.field == DISTANCE && predicate.selectivity <= DISTANCE_INDEX_LIMIT;
+}
+
+// False once compile() found a value no row has, the filter then matches nothing
+bool AccidentFilter::isSatisfiable() const {
+    return satisfiable;
+}
+
+// A filter without predicates keeps every record
+bool AccidentFilter::isEmpty() const {
+    return predicates.empty();
+}
+
+// Predicates in evaluation order once the filter is compiled
+const std::vector<AccidentFilter::Predicate>& AccidentFilter::getPredicates() const {
+    return predicates;
+}
+
+// Keep selected only the rows of the bitmap that match every predicate. First the zones of the
+// store whose zone map rules out a predicate are cleared. Then the indexes are ANDed in: the bitmap
+// indexes for severity and state, the posting lists of the city index for the cities, the zipcode
+// index for a numeric zipcode and the distance index for a distance range that keeps few rows. The
+// remaining predicates are scans of their column that skip the cleared zones and the words the
+// indexes already cleared
+void AccidentFilter::select(const RecordStore& store, RowBitmap& rows) const {
+    size_t count = std::min(rows.size(), store.size());
+    if (!satisfiable) {
+        rows.clear();
+        return;
+    }
+    const std::vector<ZoneMap>& zones = store.zones();
+    std::vector<char> skipped(zones.size(), 0);
+    for (size_t zone = 0; zone < zones.size() && !predicates.empty(); ++zone) {
+        if (!mayMatch(zones[zone])) {
+            skipped[zone] = 1;
+            size_t first = zone * SCAN_MORSEL_WORDS, last = std::min(rows.wordCount(), first + SCAN_MORSEL_WORDS);
+            if (first < last) {
+                std::fill(rows.data() + first, rows.data() + last, 0);
+            }
+        }
+    }
+    for (const auto& predicate : predicates) {
+        const RoaringBitmap* indexed = nullptr;
+        if (predicate.field == SEVERITY) {
+            if (predicate.severity < 0 || predicate.severity > UINT8_MAX) {
+                rows.clear();
+                return;
+            }
+            indexed = store.severityBitmaps().rows(static_cast<uint32_t>(predicate.severity));
+        } else if (predicate.field == STATE) {
+            indexed = store.stateBitmaps().rows(predicate.code);
+        } else if (predicate.field == CITY) {
+            store.cityNames().andInto(predicate.codes, rows);
+            continue;
+        } else if (predicate.byZipKey()) {
+            store.sortedZipcodes().andInto(predicate.keyLow, predicate.keyHigh, rows);
+            continue;
+        } else if (usesDistanceIndex(predicate)) {
+            store.sortedDistances().andInto(predicate.low, predicate.high, rows);
+            continue;
+        } else {
+            continue;
+        }
+        if (indexed == nullptr) {
+            rows.clear();
+            return;
+        }
+        indexed->andInto(rows);
+    }
+    //the column scans run morsel by morsel on the scheduler, every predicate in turn on a morsel
+    //while its words are in cache
+    uint64_t* words = rows.data();
+    parallelFor((count + 63) / 64, SCAN_MORSEL_WORDS, [&](size_t begin, size_t end, unsigned) {
+        //a single thread gets the whole range in one call, it is still taken a zone at a time
+        for (size_t zoneBegin = begin; zoneBegin < end; zoneBegin += SCAN_MORSEL_WORDS) {
+            if (skipped[zoneBegin / SCAN_MORSEL_WORDS])
+                continue;
+            size_t zoneEnd = std::min(end, zoneBegin + SCAN_MORSEL_WORDS);
+            size_t first = zoneBegin * 64, last = std::min(count, zoneEnd * 64);
+            for (const auto& predicate : predicates) {
+                if (predicate.field == ZIPCODE && !predicate.byZipKey()) {
+                    scanAndEqual(store.zipColumn() + first, last - first, predicate.code, words + zoneBegin);
+                } else if (predicate.field == DISTANCE && !usesDistanceIndex(predicate)) {
+                    scanAndBetween(store.distanceColumn() + first, last - first, predicate.low, predicate.high, words + zoneBegin);
+                }
+            }
+        }
+    });
+}
+
+// False when the zone map shows that no row of the zone can match every predicate
+bool AccidentFilter::mayMatch(const ZoneMap& zone) const {
+    for (const auto& predicate : predicates) {
+        switch (predicate.field) {
+            case SEVERITY:
+                if (predicate.severity < zone.minSeverity || predicate.severity > zone.maxSeverity) return false;
+                break;
+            case CITY:
+                if (std::none_of(predicate.codes.begin(), predicate.codes.end(), [&zone](uint32_t code) { return zone.cities.mayContain(code); }))
+                    return false;
+                break;
+            case STATE:
+                if (!zone.states.mayContain(predicate.code)) return false;
+                break;
+            case ZIPCODE:
+                if (predicate.byZipKey() ? predicate.keyHigh < zone.minZipKey || predicate.keyLow > zone.maxZipKey
+                                         : !zone.zipcodes.mayContain(predicate.code))
+                    return false;
+                break;
+            case DISTANCE:
+                if (predicate.high < zone.minDistance || predicate.low > zone.maxDistance) return false;
+                break;
+        }
+    }
+    return true;
+}
+
+// Number of rows of the bitmap that match every predicate
+size_t AccidentFilter::count(const RecordStore& store, const RowBitmap& rows) const {
+    RowBitmap selected = rows;
+    select(store, selected);
+    return selected.count();
+}
@@ -0,0 +1,84 @@
+#ifndef US_TRAFFIC_INCIDENTS_ACCIDENTFILTER_H
+#define US_TRAFFIC_INCIDENTS_ACCIDENTFILTER_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "RecordStore.h"
+#include "RowBitmap.h"
+
+// A conjunction of equality predicates on severity, city, state and zipcode and of a range on
+// distance. A city matches whatever its case, and a city ending in * every city that starts with
+// the rest. A zipcode of 1 to 5 digits matches every zipcode it starts, ZIP+4 included, and a
+// ZIP+4 only itself. The predicates are compiled once against a RecordStore (strings become
+// dictionary codes, and they are put in the order they should be checked in, most selective
+// first), then matches() is evaluated per row in a single pass over the data, or select() answers
+// them with the indexes and the vectorized column scans of the store
+class AccidentFilter {
+public:
+    enum Field { SEVERITY, CITY, STATE, ZIPCODE, DISTANCE };
+
+    struct Predicate {
+        Field field;
+        int severity;
+        std::string value;
+        uint32_t code;
+        double low, high; // distance range, both included
+        double selectivity;
+        uint32_t keyLow = ZipIndex::NO_KEY, keyHigh = ZipIndex::NO_KEY; // zipcode keys, both included
+        std::vector<uint32_t> codes; // sorted codes of the cities a city predicate matches
+
+        bool byZipKey() const { return field == ZIPCODE && keyLow != ZipIndex::NO_KEY; }
+    };
+
+    void requireSeverity(int severity);
+    void requireCity(const std::string& city);
+    void requireState(const std::string& state);
+    void requireZipcode(const std::string& zipcode);
+    void requireDistance(double low, double high);
+    void compile(const RecordStore& store);
+    bool isEmpty() const;
+    bool isSatisfiable() const;
+    const std::vector<Predicate>& getPredicates() const;
+    static bool usesDistanceIndex(const Predicate& predicate);
+    void select(const RecordStore& store, RowBitmap& rows) const;
+    bool mayMatch(const ZoneMap& zone) const;
+    size_t count(const RecordStore& store, const RowBitmap& rows) const;
+
+    bool matches(const RecordStore& store, RowId row) const {
+        if (!satisfiable) return false;
+        for (const auto& predicate : predicates) {
+            switch (predicate.field) {
+                case SEVERITY:
+                    if (store.severity(row) != predicate.severity) return false;
+                    break;
+                case CITY:
+                    if (predicate.codes.size() == 1 ? store.cityCode(row) != predicate.codes[0]
+                                                    : !std::binary_search(predicate.codes.begin(), predicate.codes.end(), store.cityCode(row)))
+                        return false;
+                    break;
+                case STATE:
+                    if (store.stateCode(row) != predicate.code) return false;
+                    break;
+                case ZIPCODE:
+                    if (predicate.byZipKey()) {
+                        uint32_t key = store.zipKey(row);
+                        if (key < predicate.keyLow || key > predicate.keyHigh) return false;
+                    } else if (store.zipCode(row) != predicate.code) {
+                        return false;
+                    }
+                    break;
+                case DISTANCE:
+                    if (!(store.distance(row) >= predicate.low && store.distance(row) <= predicate.high)) return false;
+                    break;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::vector<Predicate> predicates;
+    bool satisfiable = true;
+};
+
+#endif //US_TRAFFIC_INCIDENTS_ACCIDENTFILTER_H
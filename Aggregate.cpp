@@ -0,0 +1,32 @@
+#include "Aggregate.h"
+#include <limits>
+
+// Empty totals, the minimum and maximum start out of range so the first record sets them
+Aggregate::Aggregate()
+        : count(0), severityCount{}, distanceSum(0.0),
+          distanceMin(std::numeric_limits<double>::infinity()), distanceMax(-std::numeric_limits<double>::infinity()) {}
+
+// Add a single accident to the totals
+void Aggregate::addRecord(int severity, double distance) {
+    ++count;
+    ++severityCount[(severity >= 1 && severity <= MAX_SEVERITY) ? severity : 0];
+    distanceSum += distance;
+    if (distance < distanceMin) distanceMin = distance;
+    if (distance > distanceMax) distanceMax = distance;
+}
+
+// Merge the totals of another set of accidents
+void Aggregate::add(const Aggregate& other) {
+    count += other.count;
+    for (int i = 0; i <= MAX_SEVERITY; ++i) {
+        severityCount[i] += other.severityCount[i];
+    }
+    distanceSum += other.distanceSum;
+    if (other.distanceMin < distanceMin) distanceMin = other.distanceMin;
+    if (other.distanceMax > distanceMax) distanceMax = other.distanceMax;
+}
+
+// Mean distance, 0 for an empty set
+double Aggregate::distanceAverage() const {
+    return count > 0 ? distanceSum / count : 0.0;
+}
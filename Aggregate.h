@@ -0,0 +1,22 @@
+#ifndef US_TRAFFIC_INCIDENTS_AGGREGATE_H
+#define US_TRAFFIC_INCIDENTS_AGGREGATE_H
+
+constexpr int MAX_SEVERITY = 4;
+
+// Totals over a set of accidents: count per severity (slot 0 holds severities outside 1-4)
+// and the sum, minimum and maximum distance. Every red-black tree node keeps the totals of its
+// subtree, and the group-by operator keeps one per group
+struct Aggregate {
+    int count;
+    int severityCount[MAX_SEVERITY + 1];
+    double distanceSum;
+    double distanceMin;
+    double distanceMax;
+
+    Aggregate();
+    void addRecord(int severity, double distance);
+    void add(const Aggregate& other);
+    double distanceAverage() const;
+};
+
+#endif //US_TRAFFIC_INCIDENTS_AGGREGATE_H
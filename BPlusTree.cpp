@@ -0,0 +1,639 @@
+#include "BPlusTree.h"
+#include <algorithm>
+#include <iostream>
+
+// Deepest path findLeaf can record, far more than 16-way nodes need for 2^32 keys
+constexpr int BPLUS_MAX_DEPTH = 32;
+
+// Constructor initializes an empty tree over the rows of the given store
+BPlusTree::BPlusTree(RecordStore& store) : store(&store), root(nullptr), head(nullptr), size(0) {}
+
+// Destructor frees every node, the records themselves belong to the store
+BPlusTree::~BPlusTree() {
+    destroy(root);
+}
+
+// Free the subtree rooted at the given node
+void BPlusTree::destroy(BPlusNode* node) {
+    if (node == nullptr)
+        return;
+    if (node->isLeaf) {
+        delete static_cast<BPlusLeaf*>(node);
+        return;
+    }
+    auto* inner = static_cast<BPlusInner*>(node);
+    for (int i = 0; i <= inner->count; ++i) {
+        destroy(inner->children[i]);
+    }
+    delete inner;
+}
+
+// Pack the first 16 bytes of the ID into two big-endian words
+BPlusKey BPlusTree::makeKey(std::string_view id) {
+    BPlusKey key{0, 0};
+    for (size_t i = 0; i < id.size() && i < BPLUS_MAX_ID_LENGTH; ++i) {
+        uint64_t byte = static_cast<unsigned char>(id[i]);
+        if (i < 8) {
+            key.hi |= byte << (56 - 8 * i);
+        } else {
+            key.lo |= byte << (56 - 8 * (i - 8));
+        }
+    }
+    return key;
+}
+
+// Index of the child that covers the key, the keys of an inner node are scanned in order
+// because all of them sit in the same few cache lines
+int BPlusTree::childIndex(const BPlusInner* node, const BPlusKey& key) {
+    int i = 0;
+    while (i < node->count &&
+           (node->keyHi[i] < key.hi || (node->keyHi[i] == key.hi && node->keyLo[i] <= key.lo))) {
+        ++i;
+    }
+    return i;
+}
+
+// Position of the first key in the leaf that is not smaller than the given key
+int BPlusTree::leafLowerBound(const BPlusLeaf* leaf, const BPlusKey& key) {
+    int low = 0, high = leaf->count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (leaf->keyHi[mid] < key.hi || (leaf->keyHi[mid] == key.hi && leaf->keyLo[mid] < key.lo)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// Walk down to the leaf that covers the key, remembering the inner nodes and child slots on the way
+// when a path is given so inserts and removes can fix the parents without parent pointers
+BPlusLeaf* BPlusTree::findLeaf(const BPlusKey& key, BPlusInner** path, int* slots, int& depth) const {
+    depth = 0;
+    BPlusNode* node = root;
+    while (!node->isLeaf) {
+        auto* inner = static_cast<BPlusInner*>(node);
+        int slot = childIndex(inner, key);
+        if (path != nullptr) {
+            path[depth] = inner;
+            slots[depth] = slot;
+        }
+        ++depth;
+        node = inner->children[slot];
+    }
+    return static_cast<BPlusLeaf*>(node);
+}
+
+// Insert the separator key and the new right sibling into the parents, splitting them while they are full
+void BPlusTree::insertIntoParent(BPlusInner** path, int* slots, int depth, const BPlusKey& key, BPlusNode* right) {
+    uint64_t upHi = key.hi, upLo = key.lo;
+    BPlusNode* upNode = right;
+
+    while (depth > 0) {
+        BPlusInner* parent = path[depth - 1];
+        int slot = slots[depth - 1];
+
+        if (parent->count < BPLUS_INNER_KEYS) {
+            for (int i = parent->count; i > slot; --i) {
+                parent->keyHi[i] = parent->keyHi[i - 1];
+                parent->keyLo[i] = parent->keyLo[i - 1];
+                parent->children[i + 1] = parent->children[i];
+            }
+            parent->keyHi[slot] = upHi;
+            parent->keyLo[slot] = upLo;
+            parent->children[slot + 1] = upNode;
+            ++parent->count;
+            return;
+        }
+
+        //the parent is full, lay out all the keys in order and push the middle one up
+        uint64_t hi[BPLUS_INNER_KEYS + 1], lo[BPLUS_INNER_KEYS + 1];
+        BPlusNode* children[BPLUS_INNER_KEYS + 2];
+        for (int i = 0, j = 0; i <= BPLUS_INNER_KEYS; ++i) {
+            if (i == slot) {
+                hi[i] = upHi;
+                lo[i] = upLo;
+            } else {
+                hi[i] = parent->keyHi[j];
+                lo[i] = parent->keyLo[j];
+                ++j;
+            }
+        }
+        for (int i = 0, j = 0; i <= BPLUS_INNER_KEYS + 1; ++i) {
+            children[i] = (i == slot + 1) ? upNode : parent->children[j++];
+        }
+
+        int mid = (BPLUS_INNER_KEYS + 1) / 2;
+        auto* sibling = new BPlusInner();
+        parent->count = mid;
+        for (int i = 0; i < mid; ++i) {
+            parent->keyHi[i] = hi[i];
+            parent->keyLo[i] = lo[i];
+            parent->children[i] = children[i];
+        }
+        parent->children[mid] = children[mid];
+
+        sibling->count = BPLUS_INNER_KEYS - mid;
+        for (int i = 0; i < sibling->count; ++i) {
+            sibling->keyHi[i] = hi[mid + 1 + i];
+            sibling->keyLo[i] = lo[mid + 1 + i];
+            sibling->children[i] = children[mid + 1 + i];
+        }
+        sibling->children[sibling->count] = children[BPLUS_INNER_KEYS + 1];
+
+        upHi = hi[mid];
+        upLo = lo[mid];
+        upNode = sibling;
+        --depth;
+    }
+
+    //the root itself was split, grow the tree by one level
+    auto* newRoot = new BPlusInner();
+    newRoot->count = 1;
+    newRoot->keyHi[0] = upHi;
+    newRoot->keyLo[0] = upLo;
+    newRoot->children[0] = root;
+    newRoot->children[1] = upNode;
+    root = newRoot;
+}
+
+// Insert a new record into the B+ tree, the data goes to the store. False when the record was
+// rejected: an ID longer than the keys, an ID already in the tree or a value the store refuses
+bool BPlusTree::insert(const std::string& id, int severity, double distance, const std::string& city, const std::string& state, const std::string& zipcode) {
+    if (id.size() > BPLUS_MAX_ID_LENGTH) {
+        std::cout << "ID " << id << " is too long for the B+ tree, no element inserted." << std::endl;
+        return false;
+    }
+    if (search(id) != NO_ROW) {
+        std::cout << "ID " << id << " is already in the tree, no element inserted." << std::endl;
+        return false;
+    }
+    RowId row = store->append(id, severity, distance, city, state, zipcode);
+    return row != NO_ROW && insertRow(row);
+}
+
+// Index a row that is already in the store, IDs are unique so a repeated ID is rejected. False
+// when the row was rejected, for its repeated ID or for an ID longer than the keys
+bool BPlusTree::insertRow(RowId row) {
+    std::string_view id = store->id(row);
+    if (id.size() > BPLUS_MAX_ID_LENGTH) {
+        std::cout << "ID " << id << " is too long for the B+ tree, no element inserted." << std::endl;
+        return false;
+    }
+    BPlusKey key = makeKey(id);
+
+    if (root == nullptr) {
+        auto* leaf = new BPlusLeaf();
+        root = leaf;
+        head = leaf;
+    }
+
+    BPlusInner* path[BPLUS_MAX_DEPTH];
+    int slots[BPLUS_MAX_DEPTH];
+    int depth;
+    BPlusLeaf* leaf = findLeaf(key, path, slots, depth);
+    int pos = leafLowerBound(leaf, key);
+    if (pos < leaf->count && leaf->keyHi[pos] == key.hi && leaf->keyLo[pos] == key.lo) {
+        std::cout << "ID " << id << " is already in the tree, no element inserted." << std::endl;
+        return false;
+    }
+    ++version;
+
+    BPlusLeaf* right = nullptr;
+    if (leaf->count == BPLUS_LEAF_KEYS) {
+        //split the full leaf, the upper half moves to a new leaf linked right after it
+        right = new BPlusLeaf();
+        int half = BPLUS_LEAF_KEYS / 2;
+        right->count = BPLUS_LEAF_KEYS - half;
+        for (int i = 0; i < right->count; ++i) {
+            right->keyHi[i] = leaf->keyHi[half + i];
+            right->keyLo[i] = leaf->keyLo[half + i];
+            right->records[i] = leaf->records[half + i];
+        }
+        leaf->count = half;
+
+        right->next = leaf->next;
+        if (right->next != nullptr) {
+            right->next->prev = right;
+        }
+        right->prev = leaf;
+        leaf->next = right;
+
+        if (pos > half) {
+            leaf = right;
+            pos -= half;
+        }
+    }
+
+    for (int i = leaf->count; i > pos; --i) {
+        leaf->keyHi[i] = leaf->keyHi[i - 1];
+        leaf->keyLo[i] = leaf->keyLo[i - 1];
+        leaf->records[i] = leaf->records[i - 1];
+    }
+    leaf->keyHi[pos] = key.hi;
+    leaf->keyLo[pos] = key.lo;
+    leaf->records[pos] = row;
+    ++leaf->count;
+    ++size;
+
+    if (right != nullptr) {
+        insertIntoParent(path, slots, depth, BPlusKey{right->keyHi[0], right->keyLo[0]}, right);
+    }
+    idFilter.add(IdFilter::hash(id));
+    if (idFilter.needsRebuild()) {
+        rebuildFilter(2 * static_cast<size_t>(size));
+    }
+    return true;
+}
+
+// Size the ID filter for the given number of IDs ahead of a bulk load, so it is not rebuilt each
+// time the tree doubles
+void BPlusTree::reserve(size_t ids) {
+    if (ids > idFilter.getCapacity()) {
+        rebuildFilter(ids);
+    }
+}
+
+// Refill the ID filter, sized for the given number of IDs, from the leaf chain. Done after many
+// removes or once the tree outgrew it
+void BPlusTree::rebuildFilter(size_t ids) {
+    idFilter.reset(ids);
+    for (BPlusLeaf* leaf = head; leaf != nullptr; leaf = leaf->next) {
+        for (int i = 0; i < leaf->count; ++i) {
+            idFilter.add(IdFilter::hash(store->id(leaf->records[i])));
+        }
+    }
+}
+
+// Drop the child at the end of the recorded path from its parent, removing parents that become empty
+void BPlusTree::removeFromParent(BPlusInner** path, int* slots, int depth) {
+    while (depth > 0) {
+        BPlusInner* parent = path[depth - 1];
+        int slot = slots[depth - 1];
+
+        if (parent->count == 0) {
+            //the removed child was the only one left
+            if (parent == root) {
+                delete parent;
+                root = nullptr;
+                head = nullptr;
+                return;
+            }
+            delete parent;
+            --depth;
+            continue;
+        }
+
+        //remove the child and the separator next to it, the neighbour takes over its key range
+        int keySlot = slot > 0 ? slot - 1 : 0;
+        for (int i = keySlot; i < parent->count - 1; ++i) {
+            parent->keyHi[i] = parent->keyHi[i + 1];
+            parent->keyLo[i] = parent->keyLo[i + 1];
+        }
+        for (int i = slot; i < parent->count; ++i) {
+            parent->children[i] = parent->children[i + 1];
+        }
+        --parent->count;
+        break;
+    }
+
+    //a root with a single child is just an extra level
+    while (root != nullptr && !root->isLeaf && root->count == 0) {
+        auto* oldRoot = static_cast<BPlusInner*>(root);
+        root = oldRoot->children[0];
+        delete oldRoot;
+    }
+}
+
+// Remove the record with the given ID, leaves are unlinked once they become empty
+void BPlusTree::remove(const std::string& id) {
+    BPlusInner* path[BPLUS_MAX_DEPTH];
+    int slots[BPLUS_MAX_DEPTH];
+    int depth;
+    BPlusKey key = makeKey(id);
+    BPlusLeaf* leaf = nullptr;
+    int pos = 0;
+
+    if (root != nullptr && id.size() <= BPLUS_MAX_ID_LENGTH) {
+        leaf = findLeaf(key, path, slots, depth);
+        pos = leafLowerBound(leaf, key);
+    }
+    if (leaf == nullptr || pos == leaf->count || leaf->keyHi[pos] != key.hi || leaf->keyLo[pos] != key.lo) {
+        std::cout << "Node with ID " << id << " not found in the tree." << std::endl;
+        return;
+    }
+    ++version;
+
+    for (int i = pos; i < leaf->count - 1; ++i) {
+        leaf->keyHi[i] = leaf->keyHi[i + 1];
+        leaf->keyLo[i] = leaf->keyLo[i + 1];
+        leaf->records[i] = leaf->records[i + 1];
+    }
+    --leaf->count;
+    --size;
+    //the filter still holds the ID, it is rebuilt once too many of its IDs are gone
+    idFilter.noteRemove();
+    if (idFilter.needsRebuild()) {
+        rebuildFilter(2 * static_cast<size_t>(size));
+    }
+
+    if (leaf->count > 0)
+        return;
+
+    if (leaf == root) {
+        delete leaf;
+        root = nullptr;
+        head = nullptr;
+        return;
+    }
+    if (leaf->prev != nullptr) {
+        leaf->prev->next = leaf->next;
+    } else {
+        head = leaf->next;
+    }
+    if (leaf->next != nullptr) {
+        leaf->next->prev = leaf->prev;
+    }
+    delete leaf;
+    removeFromParent(path, slots, depth);
+}
+
+// Search for the row with the given ID, NO_ROW if it is not in the tree or the filter rules it out
+RowId BPlusTree::search(const std::string& id) const {
+    if (root == nullptr || id.size() > BPLUS_MAX_ID_LENGTH || !idFilter.mayContain(IdFilter::hash(id)))
+        return NO_ROW;
+    BPlusKey key = makeKey(id);
+    int depth;
+    BPlusLeaf* leaf = findLeaf(key, nullptr, nullptr, depth);
+    int pos = leafLowerBound(leaf, key);
+    if (pos < leaf->count && leaf->keyHi[pos] == key.hi && leaf->keyLo[pos] == key.lo)
+        return leaf->records[pos];
+    return NO_ROW;
+}
+
+// Look up many IDs at once, rows[i] is the row of ids[i] or NO_ROW. All the leaves are at the same
+// depth, so a group of IDs descends level by level: at each level every ID picks its child and
+// prefetches it, and the next level starts once the whole group has asked for its nodes. The IDs
+// the filter rules out never join a group
+void BPlusTree::multiGet(const std::vector<std::string>& ids, std::vector<RowId>& rows) const {
+    constexpr size_t GROUP = 16;
+    BPlusKey keys[GROUP];
+    BPlusNode* nodes[GROUP];
+    size_t lookup[GROUP];
+    rows.assign(ids.size(), NO_ROW);
+    if (root == nullptr)
+        return;
+
+    size_t next = 0;
+    while (next < ids.size()) {
+        size_t count = 0;
+        for (; next < ids.size() && count < GROUP; ++next) {
+            const std::string& id = ids[next];
+            if (id.size() <= BPLUS_MAX_ID_LENGTH && idFilter.mayContain(IdFilter::hash(id))) {
+                lookup[count] = next;
+                keys[count] = makeKey(id);
+                nodes[count] = root;
+                ++count;
+            }
+        }
+        if (count == 0)
+            break;
+        while (!nodes[0]->isLeaf) {
+            for (size_t i = 0; i < count; ++i) {
+                auto* inner = static_cast<BPlusInner*>(nodes[i]);
+                nodes[i] = inner->children[childIndex(inner, keys[i])];
+                //every line of an inner node, which is also the header and most of the keys of a leaf
+                for (size_t offset = 0; offset < sizeof(BPlusInner); offset += 64) {
+                    prefetch(reinterpret_cast<const char*>(nodes[i]) + offset);
+                }
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            auto* leaf = static_cast<BPlusLeaf*>(nodes[i]);
+            int pos = leafLowerBound(leaf, keys[i]);
+            if (pos < leaf->count && leaf->keyHi[pos] == keys[i].hi && leaf->keyLo[pos] == keys[i].lo) {
+                rows[lookup[i]] = leaf->records[pos];
+            }
+        }
+    }
+}
+
+// Print all the records in ID order by walking the leaf chain
+void BPlusTree::inorder(OutputWriter& out) const {
+    for (BPlusLeaf* leaf = head; leaf != nullptr; leaf = leaf->next) {
+        for (int i = 0; i < leaf->count; ++i) {
+            out.row(*store, leaf->records[i]);
+        }
+    }
+}
+
+// Find records that match the given criteria, a severity of 0 or an empty string matches anything
+std::vector<RowId> BPlusTree::find(int severity, const std::string& city, const std::string& state, const std::string& zipcode) const {
+    AccidentFilter filter;
+    if (severity != 0) filter.requireSeverity(severity);
+    if (!city.empty()) filter.requireCity(city);
+    if (!state.empty()) filter.requireState(state);
+    if (!zipcode.empty()) filter.requireZipcode(zipcode);
+    filter.compile(*store);
+    return find(filter);
+}
+
+// Find records that match a compiled filter in a single pass over the leaf chain
+std::vector<RowId> BPlusTree::find(const AccidentFilter& filter) const {
+    //the predicates are evaluated by column scans over the store, the walk only tests one bit per row
+    RowBitmap selected(store->size(), true);
+    filter.select(*store, selected);
+    size_t remaining = selected.count();
+
+    std::vector<RowId> result;
+    for (BPlusLeaf* leaf = head; remaining > 0 && leaf != nullptr; leaf = leaf->next) {
+        for (int i = 0; i < leaf->count; ++i) {
+            if (selected.test(leaf->records[i])) {
+                result.push_back(leaf->records[i]);
+                --remaining;
+            }
+        }
+    }
+    return result;
+}
+
+// Check if the B+ tree is empty
+bool BPlusTree::isEmpty() const {
+    return size == 0;
+}
+
+// Get the number of records in the B+ tree
+int BPlusTree::getSize() const {
+    return size;
+}
+
+// Version of the tree, it changes with every insert and remove
+uint64_t BPlusTree::getVersion() const {
+    return version;
+}
+
+// Search for records with the given severity
+std::vector<RowId> BPlusTree::searchBySeverity(int severity) const {
+    return find(severity, "", "", "");
+}
+
+// Search for records in the given city
+std::vector<RowId> BPlusTree::searchByCity(const std::string& city) const {
+    return find(0, city, "", "");
+}
+
+// Search for records in the given state
+std::vector<RowId> BPlusTree::searchByState(const std::string& state) const {
+    return find(0, "", state, "");
+}
+
+// Search for records with the given zipcode
+std::vector<RowId> BPlusTree::searchByZipcode(const std::string& zipcode) const {
+    return find(0, "", "", zipcode);
+}
+
+// Get all the records in ID order
+std::vector<RowId> BPlusTree::getAllNodes() const {
+    std::vector<RowId> nodes;
+    nodes.reserve(size);
+    for (BPlusLeaf* leaf = head; leaf != nullptr; leaf = leaf->next) {
+        nodes.insert(nodes.end(), leaf->records, leaf->records + leaf->count);
+    }
+    return nodes;
+}
+
+// Cursor positioned on the given slot, it stops as soon as a key falls past the last key
+BPlusTree::Cursor::Cursor(BPlusLeaf* leaf, int slot, const BPlusKey& last) : leaf(leaf), slot(slot), last(last) {
+    if (this->leaf != nullptr && this->slot == this->leaf->count) {
+        this->leaf = this->leaf->next;
+        this->slot = 0;
+    }
+    if (this->leaf != nullptr && !inBounds()) {
+        this->leaf = nullptr;
+    }
+}
+
+// Check the key under the cursor against the upper end of the span, the packed keys are enough here
+bool BPlusTree::Cursor::inBounds() const {
+    uint64_t hi = leaf->keyHi[slot];
+    return hi < last.hi || (hi == last.hi && leaf->keyLo[slot] <= last.lo);
+}
+
+// Move the cursor to the next ID of the span, hopping to the next leaf at the end of this one
+void BPlusTree::Cursor::next() {
+    if (++slot == leaf->count) {
+        leaf = leaf->next;
+        slot = 0;
+    }
+    if (leaf != nullptr && !inBounds()) {
+        leaf = nullptr;
+    }
+}
+
+// Descend once to the first key not smaller than first and return a cursor that ends after last
+BPlusTree::Cursor BPlusTree::cursorFrom(const BPlusKey& first, const BPlusKey& last) const {
+    if (root == nullptr)
+        return Cursor(nullptr, 0, last);
+    int depth;
+    BPlusLeaf* leaf = findLeaf(first, nullptr, nullptr, depth);
+    return Cursor(leaf, leafLowerBound(leaf, first), last);
+}
+
+// Cursor over the IDs between lo and hi, both included
+BPlusTree::Cursor BPlusTree::rangeCursor(const std::string& lo, const std::string& hi) const {
+    Cursor cursor = cursorFrom(makeKey(lo), makeKey(hi));
+    //a lower end longer than the packed key shares its key with IDs that sort before it
+    if (lo.size() > BPLUS_MAX_ID_LENGTH) {
+        while (cursor.valid() && store->id(cursor.get()) < lo) {
+            cursor.next();
+        }
+    }
+    return cursor;
+}
+
+// Cursor over the IDs that start with the given prefix, that is the keys from the prefix padded
+// with zero bytes up to the prefix padded with 0xFF bytes
+BPlusTree::Cursor BPlusTree::prefixCursor(const std::string& prefix) const {
+    if (prefix.size() > BPLUS_MAX_ID_LENGTH)
+        return Cursor(nullptr, 0, BPlusKey{0, 0});
+    BPlusKey first = makeKey(prefix);
+    BPlusKey last = first;
+    for (size_t i = prefix.size(); i < BPLUS_MAX_ID_LENGTH; ++i) {
+        if (i < 8) {
+            last.hi |= uint64_t(0xFF) << (56 - 8 * i);
+        } else {
+            last.lo |= uint64_t(0xFF) << (56 - 8 * (i - 8));
+        }
+    }
+    return cursorFrom(first, last);
+}
+
+// Get the records with an ID between lo and hi (both included) in ID order
+std::vector<RowId> BPlusTree::rangeScan(const std::string& lo, const std::string& hi) const {
+    std::vector<RowId> nodes;
+    for (Cursor cursor = rangeCursor(lo, hi); cursor.valid(); cursor.next()) {
+        nodes.push_back(cursor.get());
+    }
+    return nodes;
+}
+
+// Get the records whose ID starts with the given prefix in ID order
+std::vector<RowId> BPlusTree::prefixScan(const std::string& prefix) const {
+    std::vector<RowId> nodes;
+    for (Cursor cursor = prefixCursor(prefix); cursor.valid(); cursor.next()) {
+        nodes.push_back(cursor.get());
+    }
+    return nodes;
+}
+
+// Filter records by severity from the given vector of records
+std::vector<RowId> BPlusTree::filterBySeverity(const std::vector<RowId>& nodes, int severity) const {
+    std::vector<RowId> filtered;
+    for (RowId row : nodes) {
+        if (store->severity(row) == severity) {
+            filtered.push_back(row);
+        }
+    }
+    return filtered;
+}
+
+// Filter records by city from the given vector of records, ignoring case
+std::vector<RowId> BPlusTree::filterByCity(const std::vector<RowId>& nodes, const std::string& city) const {
+    std::vector<RowId> filtered;
+    AccidentFilter byCity;
+    byCity.requireCity(city);
+    byCity.compile(*store);
+    for (RowId row : nodes) {
+        if (byCity.matches(*store, row)) {
+            filtered.push_back(row);
+        }
+    }
+    return filtered;
+}
+
+// Filter records by state from the given vector of records
+std::vector<RowId> BPlusTree::filterByState(const std::vector<RowId>& nodes, const std::string& state) const {
+    std::vector<RowId> filtered;
+    uint32_t code = store->states().lookup(state);
+    for (RowId row : nodes) {
+        if (store->stateCode(row) == code) {
+            filtered.push_back(row);
+        }
+    }
+    return filtered;
+}
+
+// Filter records by zipcode from the given vector of records, a 5-digit zipcode also keeps its ZIP+4
+std::vector<RowId> BPlusTree::filterByZipcode(const std::vector<RowId>& nodes, const std::string& zipcode) const {
+    std::vector<RowId> filtered;
+    AccidentFilter byZipcode;
+    byZipcode.requireZipcode(zipcode);
+    byZipcode.compile(*store);
+    for (RowId row : nodes) {
+        if (byZipcode.matches(*store, row)) {
+            filtered.push_back(row);
+        }
+    }
+    return filtered;
+}
@@ -0,0 +1,124 @@
+#ifndef US_TRAFFIC_INCIDENTS_BPLUSTREE_H
+#define US_TRAFFIC_INCIDENTS_BPLUSTREE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "RecordStore.h"
+#include "AccidentFilter.h"
+#include "OutputWriter.h"
+#include "IdFilter.h"
+
+// Node sizes are picked so that the key arrays of a node fill whole cache lines:
+// an inner node routes on 16 keys (hi words in 2 lines, lo words in 2 lines)
+constexpr int BPLUS_INNER_KEYS = 16;
+constexpr int BPLUS_LEAF_KEYS = 32;
+constexpr size_t BPLUS_MAX_ID_LENGTH = 16;
+
+// Fixed width key built from the first 16 bytes of an ID, big-endian and zero padded,
+// so comparing two keys word by word gives the same order as comparing the strings
+struct BPlusKey {
+    uint64_t hi;
+    uint64_t lo;
+};
+
+//common header of inner nodes and leaves
+struct BPlusNode {
+    bool isLeaf;
+    int count;
+
+    explicit BPlusNode(bool leaf) : isLeaf(leaf), count(0) {}
+};
+
+//inner node, children[i] holds the keys smaller than keyHi/keyLo[i]
+struct alignas(64) BPlusInner : BPlusNode {
+    uint64_t keyHi[BPLUS_INNER_KEYS];
+    uint64_t keyLo[BPLUS_INNER_KEYS];
+    BPlusNode* children[BPLUS_INNER_KEYS + 1];
+
+    BPlusInner() : BPlusNode(false) {}
+};
+
+//leaf node, leaves are linked in key order so scans never go back up the tree
+struct alignas(64) BPlusLeaf : BPlusNode {
+    uint64_t keyHi[BPLUS_LEAF_KEYS];
+    uint64_t keyLo[BPLUS_LEAF_KEYS];
+    RowId records[BPLUS_LEAF_KEYS];
+    BPlusLeaf* prev;
+    BPlusLeaf* next;
+
+    BPlusLeaf() : BPlusNode(true), prev(nullptr), next(nullptr) {}
+};
+
+class BPlusTree {
+public:
+    // Streaming cursor over the IDs of a range or a prefix, follows the leaf chain without building a vector
+    class Cursor {
+    public:
+        bool valid() const { return leaf != nullptr; }
+        RowId get() const { return leaf->records[slot]; }
+        void next();
+
+    private:
+        friend class BPlusTree;
+        Cursor(BPlusLeaf* leaf, int slot, const BPlusKey& last);
+        bool inBounds() const;
+
+        BPlusLeaf* leaf;
+        int slot;
+        BPlusKey last;
+    };
+
+private:
+    RecordStore* store;
+    BPlusNode* root;
+    BPlusLeaf* head;
+    int size;
+    uint64_t version = 0; // bumped by every insert and remove that succeeds
+    IdFilter idFilter; // rejects most IDs that are not in the tree before the descent
+
+    static BPlusKey makeKey(std::string_view id);
+    static int childIndex(const BPlusInner* node, const BPlusKey& key);
+    static int leafLowerBound(const BPlusLeaf* leaf, const BPlusKey& key);
+    Cursor cursorFrom(const BPlusKey& first, const BPlusKey& last) const;
+    BPlusLeaf* findLeaf(const BPlusKey& key, BPlusInner** path, int* slots, int& depth) const;
+    void insertIntoParent(BPlusInner** path, int* slots, int depth, const BPlusKey& key, BPlusNode* right);
+    void removeFromParent(BPlusInner** path, int* slots, int depth);
+    void destroy(BPlusNode* node);
+    void rebuildFilter(size_t ids);
+
+public:
+    explicit BPlusTree(RecordStore& store);
+    ~BPlusTree();
+    BPlusTree(const BPlusTree&) = delete;
+    BPlusTree& operator=(const BPlusTree&) = delete;
+
+    bool insert(const std::string& id, int severity, double distance, const std::string& city, const std::string& state, const std::string& zipcode);
+    bool insertRow(RowId row);
+    void remove(const std::string& id);
+    void reserve(size_t ids);
+    RowId search(const std::string& id) const;
+    void multiGet(const std::vector<std::string>& ids, std::vector<RowId>& rows) const;
+    void inorder(OutputWriter& out) const;
+    std::vector<RowId> find(int severity, const std::string& city, const std::string& state, const std::string& zipcode) const;
+    std::vector<RowId> find(const AccidentFilter& filter) const;
+
+    bool isEmpty() const;
+    int getSize() const;
+    uint64_t getVersion() const;
+    std::vector<RowId> searchBySeverity(int severity) const;
+    std::vector<RowId> searchByCity(const std::string& city) const;
+    std::vector<RowId> searchByState(const std::string& state) const;
+    std::vector<RowId> searchByZipcode(const std::string& zipcode) const;
+    std::vector<RowId> getAllNodes() const;
+    std::vector<RowId> rangeScan(const std::string& lo, const std::string& hi) const;
+    std::vector<RowId> prefixScan(const std::string& prefix) const;
+    Cursor rangeCursor(const std::string& lo, const std::string& hi) const;
+    Cursor prefixCursor(const std::string& prefix) const;
+    std::vector<RowId> filterBySeverity(const std::vector<RowId>& nodes, int severity) const;
+    std::vector<RowId> filterByCity(const std::vector<RowId>& nodes, const std::string& city) const;
+    std::vector<RowId> filterByState(const std::vector<RowId>& nodes, const std::string& state) const;
+    std::vector<RowId> filterByZipcode(const std::vector<RowId>& nodes, const std::string& zipcode) const;
+};
+
+#endif //US_TRAFFIC_INCIDENTS_BPLUSTREE_H
@@ -0,0 +1,230 @@
+#include "BackgroundLoader.h"
+#include <algorithm>
+#include <iostream>
+#include <shared_mutex>
+#include <sstream>
+#include <vector>
+
+// One status line: the rows loaded and which indexes can answer yet
+void LoadStatus::print(std::ostream& out) const {
+    if (complete) {
+        out << "Loaded " << rows << " rows in " << seconds << "s, every index is ready" << std::endl;
+        return;
+    }
+    size_t percent = fileBytes == 0 ? 0 : bytesRead * 100 / fileBytes;
+    out << "Loading: " << rows << " rows (" << percent << "% of the file), ID index " << rows << " rows";
+    auto tree = [&](const char* name, size_t indexed) {
+        out << ", " << name;
+        if (bytesRead < fileBytes) {
+            out << " waiting";
+        } else if (indexed < rows) {
+            out << " " << indexed << " of " << rows << " rows";
+        } else {
+            out << " ready";
+        }
+    };
+    tree("B+ Tree", bPlusRows);
+    tree("Red Black Tree", rbTreeRows);
+    out << ", " << seconds << "s" << std::endl;
+}
+
+BackgroundLoader::BackgroundLoader(QueryEngine& engine, RecordStore& store, HashTable& hashTable, RedBlackTree& rbTree, BPlusTree& bPlusTree)
+        : engine(&engine), store(&store), hashTable(&hashTable), rbTree(&rbTree), bPlusTree(&bPlusTree) {}
+
+// A load still running when the program ends stops at the next chunk
+BackgroundLoader::~BackgroundLoader() {
+    stopping = true;
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+// Open the CSV and start loading it, false when the file cannot be opened. With announce set the
+// end of each step is written to the standard output
+bool BackgroundLoader::start(const std::string& path, bool announce) {
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "Could not open the file!" << std::endl;
+        complete = true;
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    fileBytes = static_cast<size_t>(file.tellg());
+    file.seekg(0, std::ios::beg);
+
+    this->announce = announce;
+    started = std::chrono::steady_clock::now();
+    thread = std::thread([this] { run(); });
+    return true;
+}
+
+LoadStatus BackgroundLoader::status() const {
+    LoadStatus status;
+    status.complete = complete;
+    status.rows = rows;
+    status.bytesRead = bytesRead;
+    status.fileBytes = fileBytes;
+    status.bPlusRows = bPlusRows;
+    status.rbTreeRows = rbTreeRows;
+    if (status.complete) {
+        status.seconds = seconds;
+    } else {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+        status.seconds = elapsed.count();
+    }
+    return status;
+}
+
+// Block until every row is in every structure
+void BackgroundLoader::wait() const {
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return complete.load(); });
+}
+
+// The ID index comes first, with the rows. The B+ tree, cheaper to build and the better one for ID
+// ranges, comes before the red-black tree. The row count is known by then, the ID filters of the
+// trees are sized for it so they are not rebuilt as the trees grow
+void BackgroundLoader::run() {
+    if (readRows()) {
+        report("ID index ready");
+        size_t count = rows;
+        {
+            std::unique_lock<std::shared_mutex> lock(engine->getLock());
+            bPlusTree->reserve(count);
+            rbTree->reserve(count);
+        }
+        if (buildIndex(count, bPlusRows, [this](RowId row) { bPlusTree->insertRow(row); })) {
+            report("B+ Tree ready");
+            if (buildIndex(count, rbTreeRows, [this](RowId row) { rbTree->insertRow(row); })) {
+                report("Red Black Tree ready");
+            }
+        }
+    }
+    file.close();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+    seconds = elapsed.count();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        complete = true;
+    }
+    finished.notify_all();
+}
+
+// Read the CSV in chunks: the lines of a chunk are parsed without the lock, then its rows go into
+// the store and the hash table under the exclusive lock. A row the store rejects (a value that does
+// not fit its column) or the B+ tree would reject (an ID too long for its keys or already loaded)
+// is reported and skipped. False when the load was stopped
+bool BackgroundLoader::readRows() {
+    std::string line;
+    bool isHeader = true;
+    int lineNumber = 0;
+    std::vector<TrafficAccident> chunk;
+    std::vector<int> chunkLines; // line number of each row of the chunk
+    chunk.reserve(CHUNK_ROWS);
+    chunkLines.reserve(CHUNK_ROWS);
+
+    auto publish = [&]() {
+        size_t appended = 0;
+        {
+            std::unique_lock<std::shared_mutex> lock(engine->getLock());
+            for (size_t i = 0; i < chunk.size(); ++i) {
+                //every structure has to take the row, the B+ tree refuses long and repeated IDs
+                if (chunk[i].ID.size() > BPLUS_MAX_ID_LENGTH) {
+                    std::cerr << "ID too long at line " << chunkLines[i] << ", row skipped" << std::endl;
+                    continue;
+                }
+                if (hashTable->searchByID(chunk[i].ID) != NO_ROW) {
+                    std::cerr << "Repeated ID at line " << chunkLines[i] << ", row skipped" << std::endl;
+                    continue;
+                }
+                RowId row = store->append(chunk[i]);
+                if (row == NO_ROW) {
+                    std::cerr << "Value out of range at line " << chunkLines[i] << ", row skipped" << std::endl;
+                    continue;
+                }
+                hashTable->insertRow(row);
+                ++appended;
+            }
+        }
+        rows += appended;
+        chunk.clear();
+        chunkLines.clear();
+    };
+
+    while (std::getline(file, line)) {
+        lineNumber++;
+        bytesRead += line.size() + 1;
+        //the file has Windows line endings, the \r would end up in the zipcode
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (isHeader) {
+            isHeader = false; // Skip the header
+            continue;
+        }
+
+        std::vector<std::string> tokens;
+        std::stringstream ss(line);
+        std::string token;
+        while (std::getline(ss, token, ',')) {
+            tokens.push_back(token);
+        }
+
+        // Check for empty or improperly formatted lines
+        if (tokens.size() != 6) {
+            std::cerr << "Unexpected format at line " << lineNumber << ": " << line << std::endl;
+            continue;
+        }
+
+        // Ensure essential fields are not empty
+        if (tokens[0].empty() || tokens[1].empty() || tokens[2].empty() || tokens[3].empty() || tokens[4].empty() || tokens[5].empty()) {
+            std::cerr << "Skipping line " << lineNumber << " due to empty fields: " << line << std::endl;
+            continue;
+        }
+
+        try {
+            chunk.emplace_back(tokens[0], std::stoi(tokens[1]), std::stod(tokens[2]), tokens[3], tokens[4], tokens[5]);
+            chunkLines.push_back(lineNumber);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << "Invalid data encountered at line " << lineNumber << ": " << line << "\nError: " << e.what() << std::endl;
+        } catch (const std::out_of_range& e) {
+            std::cerr << "Data out of range at line " << lineNumber << ": " << line << "\nError: " << e.what() << std::endl;
+        }
+
+        if (chunk.size() == CHUNK_ROWS) {
+            publish();
+            if (stopping)
+                return false;
+        }
+    }
+    publish();
+    bytesRead = fileBytes;
+    return true;
+}
+
+// Insert the loaded rows into a tree a chunk at a time, so the queries get the lock between
+// chunks. False when the load was stopped
+template <typename Insert>
+bool BackgroundLoader::buildIndex(size_t count, std::atomic<size_t>& indexed, Insert insert) {
+    for (size_t first = 0; first < count; first += CHUNK_ROWS) {
+        if (stopping)
+            return false;
+        size_t last = std::min(count, first + CHUNK_ROWS);
+        {
+            std::unique_lock<std::shared_mutex> lock(engine->getLock());
+            for (size_t row = first; row < last; ++row) {
+                insert(static_cast<RowId>(row));
+            }
+        }
+        indexed = last;
+    }
+    return true;
+}
+
+// Write a step of the load with the time since the start, when announcing
+void BackgroundLoader::report(const char* milestone) const {
+    if (!announce)
+        return;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+    std::cout << milestone << ": " << rows << " rows, Elapsed Time: " << elapsed.count() << "s" << std::endl;
+}
@@ -0,0 +1,78 @@
+#ifndef US_TRAFFIC_INCIDENTS_BACKGROUNDLOADER_H
+#define US_TRAFFIC_INCIDENTS_BACKGROUNDLOADER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include "QueryEngine.h"
+
+// How far the background load has come: the rows read from the CSV (the hash table and the
+// secondary indexes of the store take them as they come) and the rows each tree holds
+struct LoadStatus {
+    size_t rows = 0;
+    size_t bytesRead = 0;
+    size_t fileBytes = 0;
+    size_t bPlusRows = 0;
+    size_t rbTreeRows = 0;
+    bool complete = false;
+    double seconds = 0;
+
+    void print(std::ostream& out) const;
+};
+
+// Loads the CSV on a background thread so the menus and the server take queries right away.
+// The rows are read in chunks, each chunk goes into the store and the hash table (the ID index)
+// at once, then the B+ tree and the red-black tree are built over the loaded rows. Every chunk is
+// added under the exclusive lock of the engine, so a query sees the rows of whole chunks and is
+// answered from what is loaded so far; the planner skips a tree until it holds every row.
+// Inserts and removes wait for the load to finish
+class BackgroundLoader {
+public:
+    static constexpr size_t CHUNK_ROWS = 8192;
+
+    BackgroundLoader(QueryEngine& engine, RecordStore& store, HashTable& hashTable, RedBlackTree& rbTree, BPlusTree& bPlusTree);
+    ~BackgroundLoader();
+    BackgroundLoader(const BackgroundLoader&) = delete;
+    BackgroundLoader& operator=(const BackgroundLoader&) = delete;
+
+    bool start(const std::string& path, bool announce = false);
+    LoadStatus status() const;
+    bool isComplete() const { return complete; }
+    void wait() const;
+
+private:
+    QueryEngine* engine;
+    RecordStore* store;
+    HashTable* hashTable;
+    RedBlackTree* rbTree;
+    BPlusTree* bPlusTree;
+    std::ifstream file;
+    std::thread thread;
+    bool announce = false;
+    std::chrono::steady_clock::time_point started;
+    double seconds = 0; // time the whole load took, set before complete
+
+    std::atomic<size_t> rows{0};
+    std::atomic<size_t> bytesRead{0};
+    size_t fileBytes = 0;
+    std::atomic<size_t> bPlusRows{0};
+    std::atomic<size_t> rbTreeRows{0};
+    std::atomic<bool> complete{false};
+    std::atomic<bool> stopping{false};
+    mutable std::mutex mutex;
+    mutable std::condition_variable finished;
+
+    void run();
+    bool readRows();
+    template <typename Insert>
+    bool buildIndex(size_t count, std::atomic<size_t>& indexed, Insert insert);
+    void report(const char* milestone) const;
+};
+
+#endif //US_TRAFFIC_INCIDENTS_BACKGROUNDLOADER_H
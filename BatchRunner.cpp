@@ -0,0 +1,365 @@
+#include "BatchRunner.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include "OutputWriter.h"
+#include "Exporter.h"
+
+BatchRunner::BatchRunner(QueryEngine& engine, const BackgroundLoader* loader) : engine(&engine), loader(loader) {}
+
+// Split a line into its command word and the rest, without the spaces around them
+static void splitCommand(const std::string& line, std::string& command, std::string& rest) {
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos) {
+        command.clear();
+        rest.clear();
+        return;
+    }
+    size_t end = line.find_first_of(" \t", start);
+    command = line.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    size_t restStart = end == std::string::npos ? std::string::npos : line.find_first_not_of(" \t", end);
+    size_t restEnd = line.find_last_not_of(" \t");
+    rest = restStart == std::string::npos ? "" : line.substr(restStart, restEnd - restStart + 1);
+}
+
+// Read the field=value terms of an insert, a value in double quotes may contain spaces
+static bool parseTerms(const std::string& text, std::vector<std::pair<std::string, std::string>>& terms, std::string& error) {
+    size_t pos = 0;
+    while (true) {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) ++pos;
+        if (pos == text.size())
+            return true;
+        size_t equals = text.find('=', pos);
+        if (equals == std::string::npos) {
+            error = "Expected field=value at '" + text.substr(pos) + "'";
+            return false;
+        }
+        std::string field = text.substr(pos, equals - pos);
+        std::transform(field.begin(), field.end(), field.begin(), [](unsigned char c) { return std::tolower(c); });
+        pos = equals + 1;
+        std::string value;
+        if (pos < text.size() && text[pos] == '"') {
+            size_t end = text.find('"', pos + 1);
+            if (end == std::string::npos) {
+                error = "Missing closing quote for '" + field + "'";
+                return false;
+            }
+            value = text.substr(pos + 1, end - pos - 1);
+            pos = end + 1;
+        } else {
+            size_t start = pos;
+            while (pos < text.size() && !std::isspace(static_cast<unsigned char>(text[pos]))) ++pos;
+            value = text.substr(start, pos - start);
+        }
+        terms.emplace_back(field, value);
+    }
+}
+
+// True for a blank line or a comment, which are not commands
+bool BatchRunner::isSkipped(const std::string& line) {
+    size_t first = line.find_first_not_of(" \t\r");
+    return first == std::string::npos || line[first] == '#';
+}
+
+// True when the command changes the data (insert or remove), so it cannot run alongside readers
+bool BatchRunner::modifies(const std::string& line) {
+    std::string command, rest;
+    splitCommand(line, command, rest);
+    std::transform(command.begin(), command.end(), command.begin(), [](unsigned char c) { return std::tolower(c); });
+    return command == "insert" || command == "remove";
+}
+
+// True for a get command with a single ID, which is put in id
+bool BatchRunner::parseGet(const std::string& line, std::string& id) {
+    std::string command;
+    splitCommand(line, command, id);
+    std::transform(command.begin(), command.end(), command.begin(), [](unsigned char c) { return std::tolower(c); });
+    return command == "get" && !id.empty() && id.find_first_of(" \t") == std::string::npos;
+}
+
+// Print the row of an ID
+BatchResult BatchRunner::get(const std::string& id, std::ostream& out, std::string& error) const {
+    BatchResult result;
+    if (id.empty() || id.find_first_of(" \t") != std::string::npos) {
+        error = "get takes a single ID";
+        return result;
+    }
+    Query query;
+    query.id = id;
+    query.filter.compile(engine->getStore());
+    std::vector<RowId> rows = engine->execute(query);
+    OutputWriter writer(out);
+    for (RowId row : rows) {
+        writer.row(engine->getStore(), row);
+    }
+    result.ok = true;
+    result.rows = rows.size();
+    return result;
+}
+
+// Print the rows of the IDs separated by spaces, in their order, and the IDs that are not there
+BatchResult BatchRunner::multiGet(const std::string& ids, std::ostream& out, std::string& error) const {
+    BatchResult result;
+    std::vector<std::string> keys;
+    std::istringstream words(ids);
+    std::string id;
+    while (words >> id) {
+        keys.push_back(id);
+    }
+    if (keys.empty()) {
+        error = "mget takes one or more IDs";
+        return result;
+    }
+    std::vector<RowId> rows = engine->lookup(keys);
+    OutputWriter writer(out);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (rows[i] != NO_ROW) {
+            writer.row(engine->getStore(), rows[i]);
+            ++result.rows;
+        } else {
+            writer.text("ID " + keys[i] + " not found\n");
+        }
+    }
+    result.ok = true;
+    return result;
+}
+
+// Answer the IDs of many get commands with one batched lookup, each answer is written as get
+// writes it, with its share of the time of the whole lookup
+void BatchRunner::getMany(const std::vector<std::string>& ids, std::ostream& out) const {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<RowId> rows = engine->lookup(ids);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double share = ids.empty() ? 0.0 : elapsed.count() / ids.size();
+    //every answer ends with one of two status lines, they are formatted once
+    std::ostringstream time;
+    time << " rows, Elapsed Time: " << share << "s\n";
+    std::string found = "OK 1" + time.str(), missing = "OK 0" + time.str();
+    OutputWriter writer(out);
+    for (RowId row : rows) {
+        if (row != NO_ROW) {
+            writer.row(engine->getStore(), row);
+        }
+        writer.text(row != NO_ROW ? found : missing);
+    }
+}
+
+// Insert the accident described by the terms into every structure
+BatchResult BatchRunner::insert(const std::string& terms, std::string& error) const {
+    BatchResult result;
+    std::vector<std::pair<std::string, std::string>> fields;
+    if (!parseTerms(terms, fields, error))
+        return result;
+
+    TrafficAccident accident;
+    bool hasId = false, hasSeverity = false;
+    for (const auto& field : fields) {
+        const std::string& value = field.second;
+        try {
+            size_t used = 0;
+            if (field.first == "id") {
+                accident.ID = value;
+                hasId = !value.empty();
+            } else if (field.first == "severity") {
+                accident.severity = std::stoi(value, &used);
+                hasSeverity = used == value.size();
+            } else if (field.first == "distance") {
+                accident.distance = std::stod(value, &used);
+                if (used != value.size() || !std::isfinite(accident.distance)) {
+                    error = "Distance '" + value + "' is not a number";
+                    return result;
+                }
+            } else if (field.first == "city") {
+                accident.city = value;
+            } else if (field.first == "state") {
+                accident.state = value;
+            } else if (field.first == "zipcode") {
+                accident.zipcode = value;
+            } else {
+                error = "Unknown field '" + field.first + "'";
+                return result;
+            }
+        } catch (const std::logic_error&) {
+            error = "Value '" + value + "' of '" + field.first + "' is not a number";
+            return result;
+        }
+    }
+    if (!hasId || !hasSeverity) {
+        error = "insert needs an id and a whole number severity";
+        return result;
+    }
+    if (!engine->insert(accident, error))
+        return result;
+    result.ok = true;
+    result.rows = 1;
+    return result;
+}
+
+// Run a query of the query menu, grouped says the command was aggregate
+BatchResult BatchRunner::filter(const std::string& text, bool grouped, std::ostream& out, std::string& error) const {
+    BatchResult result;
+    const RecordStore& store = engine->getStore();
+    Query query;
+    if (!Query::parse(text, store, query, error))
+        return result;
+    if (query.hasGroup != grouped) {
+        error = grouped ? "aggregate needs a group= term" : "Use aggregate for a query with a group= term";
+        return result;
+    }
+
+    QueryPlan plan;
+    if (query.estimate) {
+        plan = engine->plan(query);
+        out << "Estimated rows: " << plan.estimatedRows << " (" << QueryPlan::pathName(plan.path) << ")\n";
+    } else if (grouped) {
+        std::vector<Group> groups = engine->aggregate(query, plan);
+        for (const auto& group : groups) {
+            GroupBy::print(store, query.groupBy, group, out);
+        }
+        result.rows = groups.size();
+    } else {
+        std::vector<RowId> rows = query.top > 0 ? engine->top(query, plan) : engine->execute(query, plan);
+        OutputWriter writer(out);
+        for (RowId row : rows) {
+            writer.row(store, row);
+        }
+        result.rows = rows.size();
+    }
+    if (query.explain) {
+        plan.print(out, query);
+    }
+    result.ok = true;
+    return result;
+}
+
+// Execute one command line and write its output followed by its status and latency. A blank
+// line or a comment does nothing and is not counted
+BatchResult BatchRunner::execute(const std::string& line, std::ostream& out) const {
+    auto start = std::chrono::steady_clock::now();
+    std::string command, rest, error;
+    splitCommand(line, command, rest);
+    std::transform(command.begin(), command.end(), command.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    BatchResult result;
+    if (command == "get") {
+        result = get(rest, out, error);
+    } else if (command == "mget") {
+        result = multiGet(rest, out, error);
+    } else if (command == "insert") {
+        result = insert(rest, error);
+    } else if (command == "remove") {
+        if (rest.empty()) {
+            error = "remove takes an ID";
+        } else if (engine->remove(rest)) {
+            result.ok = true;
+            result.rows = 1;
+        } else {
+            error = "ID " + rest + " not found";
+        }
+    } else if (command == "filter" || command == "aggregate") {
+        result = filter(rest, command == "aggregate", out, error);
+    } else if (command == "export") {
+        result = exportRows(rest, error);
+    } else if (command == "status") {
+        //without a loader the data was loaded before the runner started
+        if (loader != nullptr) {
+            loader->status().print(out);
+        }
+        result.ok = true;
+    } else {
+        error = "Unknown command '" + command + "', use get, mget, insert, remove, filter, aggregate, export or status";
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    result.seconds = elapsed.count();
+    if (result.ok) {
+        out << "OK " << result.rows << " rows, Elapsed Time: " << result.seconds << "s\n";
+    } else {
+        out << "ERROR " << error << ", Elapsed Time: " << result.seconds << "s\n";
+    }
+    return result;
+}
+
+// Write the rows of a query to a file, the first word is the path and the rest the query
+BatchResult BatchRunner::exportRows(const std::string& text, std::string& error) const {
+    BatchResult result;
+    size_t space = text.find_first_of(" \t");
+    std::string path = text.substr(0, space);
+    Query query;
+    if (path.empty()) {
+        error = "export takes a file and a query";
+        return result;
+    }
+    if (!Query::parse(space == std::string::npos ? "" : text.substr(space + 1), engine->getStore(), query, error))
+        return result;
+    if (query.hasGroup || query.explain || query.estimate) {
+        error = "export takes a query without group=, explain or estimate";
+        return result;
+    }
+    QueryPlan plan;
+    std::vector<RowId> rows = query.top > 0 ? engine->top(query, plan) : engine->execute(query, plan);
+    if (!Exporter::write(engine->getStore(), rows, path, error))
+        return result;
+    result.ok = true;
+    result.rows = rows.size();
+    return result;
+}
+
+// Block until the background load is done, inserts and removes only run on the complete data
+void BatchRunner::waitForLoad() const {
+    if (loader != nullptr) {
+        loader->wait();
+    }
+}
+
+// Execute every command of the input, then return the latency statistics of the run
+BatchSummary BatchRunner::run(std::istream& in, std::ostream& out) const {
+    BatchSummary summary;
+    auto start = std::chrono::steady_clock::now();
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (isSkipped(line))
+            continue;
+        out << "> " << line << '\n';
+        summary.add(execute(line, out));
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    summary.totalSeconds = elapsed.count();
+    return summary;
+}
+
+// Count a command
+void BatchSummary::add(const BatchResult& result) {
+    ++commands;
+    if (!result.ok) {
+        ++errors;
+    }
+    latencies.push_back(result.seconds);
+}
+
+// Latency below which the given share of the commands fall
+double BatchSummary::percentile(double fraction) {
+    if (latencies.empty())
+        return 0.0;
+    auto rank = static_cast<size_t>(std::ceil(fraction * latencies.size()));
+    auto nth = latencies.begin() + static_cast<std::ptrdiff_t>(std::min(std::max<size_t>(rank, 1), latencies.size()) - 1);
+    std::nth_element(latencies.begin(), nth, latencies.end());
+    return *nth;
+}
+
+// Print the totals and the latency percentiles of the run
+void BatchSummary::print(std::ostream& out) {
+    out << "Commands: " << commands << ", Errors: " << errors << ", Total Time: " << totalSeconds << "s";
+    if (totalSeconds > 0) {
+        out << ", Throughput: " << commands / totalSeconds << " commands/s";
+    }
+    out << '\n';
+    out << "Latency p50: " << percentile(0.5) << "s, p90: " << percentile(0.9) << "s, p99: " << percentile(0.99)
+        << "s, Max: " << percentile(1.0) << "s" << std::endl;
+}
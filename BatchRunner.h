@@ -0,0 +1,67 @@
+#ifndef US_TRAFFIC_INCIDENTS_BATCHRUNNER_H
+#define US_TRAFFIC_INCIDENTS_BATCHRUNNER_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "QueryEngine.h"
+#include "BackgroundLoader.h"
+
+// Outcome of one batch command: whether it succeeded, how many rows or groups it returned and
+// how long it took, parsing included
+struct BatchResult {
+    bool ok = false;
+    size_t rows = 0;
+    double seconds = 0;
+};
+
+// Latency statistics of a run of batch commands
+struct BatchSummary {
+    size_t commands = 0;
+    size_t errors = 0;
+    double totalSeconds = 0;
+    std::vector<double> latencies;
+
+    void add(const BatchResult& result);
+    double percentile(double fraction);
+    void print(std::ostream& out);
+};
+
+// Non-interactive access to the structures: one command per line, executed in a loop with no
+// menu. The commands are
+//   get <id>
+//   mget <id> <id> ...  (many IDs in one batched lookup)
+//   insert id=A-1 severity=2 distance=0.5 city="San Antonio" state=TX zipcode=78201
+//   remove <id>
+//   filter <query>      (the terms of the query menu, top= included)
+//   aggregate <query>   (a query with a group= term)
+//   status              (how far the background load has come)
+//   export <file> <query>  (the rows of the query to a .csv or a columnar .col file)
+// Blank lines and lines starting with # are skipped. Every command writes its rows, then an
+// OK or ERROR line with its row count and latency
+class BatchRunner {
+public:
+    explicit BatchRunner(QueryEngine& engine, const BackgroundLoader* loader = nullptr);
+
+    static bool isSkipped(const std::string& line);
+    static bool modifies(const std::string& line);
+    static bool parseGet(const std::string& line, std::string& id);
+
+    BatchResult execute(const std::string& line, std::ostream& out) const;
+    void getMany(const std::vector<std::string>& ids, std::ostream& out) const;
+    BatchSummary run(std::istream& in, std::ostream& out) const;
+    void waitForLoad() const;
+
+private:
+    QueryEngine* engine;
+    const BackgroundLoader* loader;
+
+    BatchResult get(const std::string& id, std::ostream& out, std::string& error) const;
+    BatchResult multiGet(const std::string& ids, std::ostream& out, std::string& error) const;
+    BatchResult insert(const std::string& terms, std::string& error) const;
+    BatchResult filter(const std::string& text, bool grouped, std::ostream& out, std::string& error) const;
+    BatchResult exportRows(const std::string& text, std::string& error) const;
+};
+
+#endif //US_TRAFFIC_INCIDENTS_BATCHRUNNER_H
@@ -0,0 +1,177 @@
+#include "CityIndex.h"
+#include <algorithm>
+#include <cctype>
+#include "TopK.h"
+
+// Case-folded form of a name, the form the trie is built on
+std::string CityIndex::fold(const std::string& name) {
+    std::string folded = name;
+    std::transform(folded.begin(), folded.end(), folded.begin(), [](unsigned char c) { return std::tolower(c); });
+    return folded;
+}
+
+// Add a new city of the dictionary: walk its folded name down the trie, adding the missing nodes
+// in their place in the sorted sibling lists, and list the code on the last node
+void CityIndex::addCity(uint32_t code, const std::string& name) {
+    if (code >= postings.size()) {
+        postings.resize(code + 1);
+    }
+    uint32_t node = 0;
+    for (char label : fold(name)) {
+        uint32_t* link = &nodes[node].firstChild;
+        while (*link != NONE && nodes[*link].label < label) {
+            link = &nodes[*link].nextSibling;
+        }
+        if (*link == NONE || nodes[*link].label != label) {
+            TrieNode child{label};
+            child.nextSibling = *link;
+            auto added = static_cast<uint32_t>(nodes.size());
+            //link points into nodes, set it before the push_back can move the array
+            *link = added;
+            nodes.push_back(child);
+            node = added;
+        } else {
+            node = *link;
+        }
+    }
+    if (nodes[node].namesake == NONE) {
+        nodes[node].namesake = static_cast<uint32_t>(namesakes.size());
+        namesakes.emplace_back();
+    }
+    namesakes[nodes[node].namesake].push_back(code);
+}
+
+// Add a row to the posting list of its city
+void CityIndex::addRow(uint32_t code, RowId row) {
+    postings[code].push_back(row);
+}
+
+// Node reached by the folded text, NONE when no name starts that way
+uint32_t CityIndex::find(const std::string& folded) const {
+    uint32_t node = 0;
+    for (char label : folded) {
+        node = nodes[node].firstChild;
+        while (node != NONE && nodes[node].label < label) {
+            node = nodes[node].nextSibling;
+        }
+        if (node == NONE || nodes[node].label != label)
+            return NONE;
+    }
+    return node;
+}
+
+// Call visit(namesake) for every name ending in the subtree of the node, in alphabetical order
+template <typename Visit>
+void CityIndex::forEachName(uint32_t node, Visit visit) const {
+    std::vector<uint32_t> stack{node};
+    while (!stack.empty()) {
+        uint32_t current = stack.back();
+        stack.pop_back();
+        if (nodes[current].namesake != NONE) {
+            visit(nodes[current].namesake);
+        }
+        //push the children last to first so the first one is visited next
+        size_t mark = stack.size();
+        for (uint32_t child = nodes[current].firstChild; child != NONE; child = nodes[child].nextSibling) {
+            stack.push_back(child);
+        }
+        std::reverse(stack.begin() + static_cast<std::ptrdiff_t>(mark), stack.end());
+    }
+}
+
+// Codes of the cities with this name, ignoring case
+std::vector<uint32_t> CityIndex::exact(const std::string& name) const {
+    uint32_t node = find(fold(name));
+    if (node == NONE || nodes[node].namesake == NONE)
+        return {};
+    return namesakes[nodes[node].namesake];
+}
+
+// Codes of the cities whose name starts with the text, ignoring case
+std::vector<uint32_t> CityIndex::prefix(const std::string& start) const {
+    std::vector<uint32_t> codes;
+    uint32_t node = find(fold(start));
+    if (node == NONE)
+        return codes;
+    forEachName(node, [&](uint32_t namesake) {
+        codes.insert(codes.end(), namesakes[namesake].begin(), namesakes[namesake].end());
+    });
+    return codes;
+}
+
+// Autocomplete: the limit names starting with the text that have the most rows, most rows first.
+// Names that only differ in case count as one, represented by the spelling with the most rows. The
+// posting lists keep removed rows, so the rows are counted by the caller, rowCounts[code] for the
+// rows of a city code still in the table (codes past its end have none), and names without rows
+// are left out
+std::vector<uint32_t> CityIndex::complete(const std::string& start, size_t limit, const std::vector<uint32_t>& rowCounts) const {
+    struct Suggestion {
+        size_t rows;
+        uint32_t code;
+    };
+    auto better = [](const Suggestion& a, const Suggestion& b) {
+        return a.rows != b.rows ? a.rows > b.rows : a.code < b.code;
+    };
+    BoundedHeap<Suggestion, decltype(better)> best(limit, better);
+    uint32_t node = find(fold(start));
+    if (node != NONE) {
+        forEachName(node, [&](uint32_t namesake) {
+            Suggestion suggestion{0, namesakes[namesake][0]};
+            size_t mostRows = 0;
+            for (uint32_t code : namesakes[namesake]) {
+                size_t rows = code < rowCounts.size() ? rowCounts[code] : 0;
+                suggestion.rows += rows;
+                if (rows > mostRows) {
+                    mostRows = rows;
+                    suggestion.code = code;
+                }
+            }
+            if (suggestion.rows == 0)
+                return;
+            best.push(suggestion);
+        });
+    }
+    std::vector<uint32_t> codes;
+    for (const auto& suggestion : best.sorted()) {
+        codes.push_back(suggestion.code);
+    }
+    return codes;
+}
+
+// Number of rows of the cities
+size_t CityIndex::rowCount(const std::vector<uint32_t>& codes) const {
+    size_t count = 0;
+    for (uint32_t code : codes) {
+        count += postings[code].size();
+    }
+    return count;
+}
+
+// Keep selected only the rows of the bitmap in one of the cities, from their posting lists
+void CityIndex::andInto(const std::vector<uint32_t>& codes, RowBitmap& rows) const {
+    RowBitmap inCities(rows.size());
+    for (uint32_t code : codes) {
+        for (RowId row : postings[code]) {
+            if (row < rows.size()) {
+                inCities.set(row);
+            }
+        }
+    }
+    uint64_t* words = rows.data();
+    const uint64_t* keep = inCities.data();
+    for (size_t w = 0; w < rows.wordCount(); ++w) {
+        words[w] &= keep[w];
+    }
+}
+
+// Bytes held by the trie and the posting lists
+size_t CityIndex::memoryBytes() const {
+    size_t bytes = nodes.capacity() * sizeof(TrieNode);
+    for (const auto& codes : namesakes) {
+        bytes += sizeof(codes) + codes.capacity() * sizeof(uint32_t);
+    }
+    for (const auto& rows : postings) {
+        bytes += sizeof(rows) + rows.capacity() * sizeof(RowId);
+    }
+    return bytes;
+}
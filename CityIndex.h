@@ -0,0 +1,50 @@
+#ifndef US_TRAFFIC_INCIDENTS_CITYINDEX_H
+#define US_TRAFFIC_INCIDENTS_CITYINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "RowId.h"
+#include "RowBitmap.h"
+
+// Index on the city names: a trie over the case-folded names of the city dictionary, each name
+// ending on a node that lists the dictionary codes spelled that way (McLean and Mclean are the same
+// city once folded), and a posting list with the rows of each code. A name, a case-insensitive name
+// or a prefix is a walk of as many nodes as it has characters, so a lookup costs the same whatever the
+// number of rows. The nodes live in one array, the children of a node are a sibling list sorted by
+// character
+class CityIndex {
+public:
+    static std::string fold(const std::string& name);
+
+    void addCity(uint32_t code, const std::string& name);
+    void addRow(uint32_t code, RowId row);
+
+    std::vector<uint32_t> exact(const std::string& name) const;
+    std::vector<uint32_t> prefix(const std::string& start) const;
+    std::vector<uint32_t> complete(const std::string& start, size_t limit, const std::vector<uint32_t>& rowCounts) const;
+    const std::vector<RowId>& rows(uint32_t code) const { return postings[code]; }
+    size_t rowCount(const std::vector<uint32_t>& codes) const;
+    void andInto(const std::vector<uint32_t>& codes, RowBitmap& rows) const;
+    size_t memoryBytes() const;
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct TrieNode {
+        char label;
+        uint32_t firstChild = NONE;
+        uint32_t nextSibling = NONE;
+        uint32_t namesake = NONE; // index in namesakes when a name ends here
+    };
+
+    std::vector<TrieNode> nodes{TrieNode{'\0'}};
+    std::vector<std::vector<uint32_t>> namesakes;
+    std::vector<std::vector<RowId>> postings; // indexed by city code
+
+    uint32_t find(const std::string& folded) const;
+    template <typename Visit>
+    void forEachName(uint32_t node, Visit visit) const;
+};
+
+#endif //US_TRAFFIC_INCIDENTS_CITYINDEX_H
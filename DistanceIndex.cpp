@@ -0,0 +1,110 @@
+#include "DistanceIndex.h"
+
+// Fewest pending rows worth a merge on append, a lookup merges whatever is pending
+constexpr size_t MIN_PENDING = 1024;
+
+// Add a row, it is only sorted into the main array by the next merge
+void DistanceIndex::add(double distance, RowId row) {
+    pending.push_back({distance, row});
+    if (pending.size() >= std::max(MIN_PENDING, sorted.size() / 8)) {
+        merge();
+    }
+}
+
+// Number of rows indexed
+size_t DistanceIndex::size() const {
+    return sorted.size() + pending.size();
+}
+
+// Merge the pending rows before a lookup
+void DistanceIndex::settle() const {
+    std::lock_guard<std::mutex> lock(mergeLock);
+    if (!pending.empty()) {
+        merge();
+    }
+}
+
+// First row with a distance of at least low, the pending rows are merged first
+std::vector<DistanceIndex::Entry>::const_iterator DistanceIndex::lowerBound(double low) const {
+    settle();
+    return std::lower_bound(sorted.begin(), sorted.end(), low, [](const Entry& entry, double value) {
+        return entry.distance < value;
+    });
+}
+
+// Sort the pending rows and merge them into the main array, then rebuild the histogram
+void DistanceIndex::merge() const {
+    auto byDistance = [](const Entry& a, const Entry& b) {
+        return a.distance != b.distance ? a.distance < b.distance : a.row < b.row;
+    };
+    std::sort(pending.begin(), pending.end(), byDistance);
+    size_t middle = sorted.size();
+    sorted.insert(sorted.end(), pending.begin(), pending.end());
+    std::inplace_merge(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(middle), sorted.end(), byDistance);
+    pending.clear();
+
+    bounds.resize(BUCKETS + 1);
+    for (size_t i = 0; i <= BUCKETS; ++i) {
+        bounds[i] = sorted[i * (sorted.size() - 1) / BUCKETS].distance;
+    }
+}
+
+// Exact number of rows with a distance between low and high, two binary searches
+size_t DistanceIndex::countBetween(double low, double high) const {
+    if (!(low <= high))
+        return 0;
+    auto first = lowerBound(low);
+    auto last = std::upper_bound(sorted.begin(), sorted.end(), high, [](double value, const Entry& entry) {
+        return value < entry.distance;
+    });
+    return first < last ? static_cast<size_t>(last - first) : 0;
+}
+
+// Keep selected only the rows of the bitmap with a distance between low and high. Cheaper than a
+// scan of the distance column when the range holds few rows, only the words of the matching rows
+// are looked at besides the ones cleared whole
+void DistanceIndex::andInto(double low, double high, RowBitmap& rows) const {
+    std::vector<RowId> matching;
+    forEachBetween(low, high, [&matching](RowId row) { matching.push_back(row); });
+    std::sort(matching.begin(), matching.end());
+    rows.keepOnly(matching);
+}
+
+// Share of the rows with a distance between low and high, read from the histogram. Each bucket
+// holds the same share of the rows and is taken to be spread evenly between its bounds, a bucket
+// whose bounds are equal (a value many rows share, such as 0) counts fully when the value is in range
+double DistanceIndex::estimateBetween(double low, double high) const {
+    if (!(low <= high))
+        return 0.0;
+    settle();
+    if (bounds.empty())
+        return 0.0;
+    double covered = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        double from = bounds[i], to = bounds[i + 1];
+        if (to < low || from > high)
+            continue;
+        if (from == to) {
+            covered += 1;
+        } else {
+            covered += (std::min(to, high) - std::max(from, low)) / (to - from);
+        }
+    }
+    return covered / BUCKETS;
+}
+
+// Distance below which the given share of the rows falls, interpolated between the histogram bounds
+double DistanceIndex::quantile(double fraction) const {
+    settle();
+    if (bounds.empty())
+        return 0.0;
+    double position = std::min(std::max(fraction, 0.0), 1.0) * BUCKETS;
+    auto bucket = std::min(static_cast<size_t>(position), BUCKETS - 1);
+    double within = position - static_cast<double>(bucket);
+    return bounds[bucket] + (bounds[bucket + 1] - bounds[bucket]) * within;
+}
+
+// Bytes held by the index
+size_t DistanceIndex::memoryBytes() const {
+    return (sorted.capacity() + pending.capacity()) * sizeof(Entry) + bounds.capacity() * sizeof(double);
+}
@@ -0,0 +1,57 @@
+#ifndef US_TRAFFIC_INCIDENTS_DISTANCEINDEX_H
+#define US_TRAFFIC_INCIDENTS_DISTANCEINDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "RowId.h"
+#include "RowBitmap.h"
+
+// Secondary index on distance: the rows sorted by (distance, row), so a range or a threshold is a
+// binary search plus a walk over the rows that match. The store only takes finite distances, so
+// that order is a strict one. Appends go to a pending list that is sorted and merged into the main
+// array once it grows past an eighth of it, and a lookup or an estimate merges whatever is pending
+// first, so every answer comes from the sorted rows. Every merge also rebuilds an equi-depth
+// histogram, BUCKETS + 1 bounds with the same number of rows between two of them, which answers
+// quantiles and range estimates without touching the rows. Lookups run under the shared lock of the
+// engine and appends under its exclusive one; the merge a lookup does is serialized by a lock of
+// its own
+class DistanceIndex {
+public:
+    static constexpr size_t BUCKETS = 256;
+
+    void add(double distance, RowId row);
+    size_t size() const;
+    size_t countBetween(double low, double high) const;
+    void andInto(double low, double high, RowBitmap& rows) const;
+    double estimateBetween(double low, double high) const;
+    double quantile(double fraction) const;
+    size_t memoryBytes() const;
+
+    // Call visit(row) for every row with a distance between low and high, both included, in
+    // increasing distance
+    template <typename Visit>
+    void forEachBetween(double low, double high, Visit visit) const {
+        for (auto it = lowerBound(low); it != sorted.end() && it->distance <= high; ++it) {
+            visit(it->row);
+        }
+    }
+
+private:
+    struct Entry {
+        double distance;
+        RowId row;
+    };
+
+    mutable std::vector<Entry> sorted;
+    mutable std::vector<Entry> pending;
+    mutable std::vector<double> bounds;
+    mutable std::mutex mergeLock;
+
+    std::vector<Entry>::const_iterator lowerBound(double low) const;
+    void settle() const;
+    void merge() const;
+};
+
+#endif //US_TRAFFIC_INCIDENTS_DISTANCEINDEX_H
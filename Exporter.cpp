@@ -0,0 +1,239 @@
+#include "Exporter.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <unordered_map>
+#include "OutputWriter.h"
+#include "Parallel.h"
+
+// Little-endian numbers and length-prefixed strings, the same on every host
+static void putU8(std::string& out, uint8_t value) {
+    out.push_back(static_cast<char>(value));
+}
+
+static void putU16(std::string& out, uint16_t value) {
+    out.push_back(static_cast<char>(value & 0xff));
+    out.push_back(static_cast<char>(value >> 8));
+}
+
+static void putU32(std::string& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<char>(value >> shift & 0xff));
+    }
+}
+
+static void putU64(std::string& out, uint64_t value) {
+    for (int shift = 0; shift < 64; shift += 8) {
+        out.push_back(static_cast<char>(value >> shift & 0xff));
+    }
+}
+
+static void putDouble(std::string& out, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putU64(out, bits);
+}
+
+static void putString(std::string& out, std::string_view value) {
+    auto length = static_cast<uint16_t>(std::min<size_t>(value.size(), UINT16_MAX));
+    putU16(out, length);
+    out.append(value.data(), length);
+}
+
+// Pick the format from the extension of the path, .csv or .col
+bool Exporter::formatOf(const std::string& path, Format& format) {
+    auto endsWith = [&path](const char* extension) {
+        size_t length = std::strlen(extension);
+        return path.size() > length && path.compare(path.size() - length, length, extension) == 0;
+    };
+    if (endsWith(".csv")) {
+        format = CSV;
+    } else if (endsWith(".col")) {
+        format = COLUMNAR;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Write the rows to the file, in the format its extension names. False with the reason in error
+// when the path has another extension or the file cannot be written
+bool Exporter::write(const RecordStore& store, const std::vector<RowId>& rows, const std::string& path, std::string& error) {
+    Format format;
+    if (!formatOf(path, format)) {
+        error = "The export file must end in .csv or .col";
+        return false;
+    }
+    return format == CSV ? writeCsv(store, rows, path, error) : writeColumnar(store, rows, path, error);
+}
+
+// CSV with the columns of the source file, streamed through the buffer of an OutputWriter
+bool Exporter::writeCsv(const RecordStore& store, const std::vector<RowId>& rows, const std::string& path, std::string& error) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        error = "Could not open " + path;
+        return false;
+    }
+    {
+        OutputWriter writer(file, OutputWriter::CSV);
+        writer.header();
+        for (RowId row : rows) {
+            writer.row(store, row);
+        }
+    }
+    if (!file) {
+        error = "Could not write " + path;
+        return false;
+    }
+    return true;
+}
+
+// The columnar file, one row group per chunk of rows with its six column blocks encoded in
+// parallel, then the footer that lists the row groups
+bool Exporter::writeColumnar(const RecordStore& store, const std::vector<RowId>& rows, const std::string& path, std::string& error) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        error = "Could not open " + path;
+        return false;
+    }
+
+    std::string header = "USTC";
+    putU32(header, VERSION);
+    file.write(header.data(), static_cast<std::streamsize>(header.size()));
+    uint64_t offset = header.size();
+
+    std::vector<std::pair<uint64_t, uint32_t>> groups;
+    std::vector<std::string> blocks(COLUMN_COUNT);
+    for (size_t first = 0; first < rows.size() && file; first += CHUNK_ROWS) {
+        size_t count = std::min(CHUNK_ROWS, rows.size() - first);
+        parallelFor(COLUMN_COUNT, 1, [&](size_t begin, size_t end, unsigned) {
+            for (size_t column = begin; column < end; ++column) {
+                blocks[column].clear();
+                encodeColumn(store, rows.data() + first, count, static_cast<Column>(column), blocks[column]);
+            }
+        });
+
+        std::string groupHeader;
+        putU32(groupHeader, static_cast<uint32_t>(count));
+        file.write(groupHeader.data(), static_cast<std::streamsize>(groupHeader.size()));
+        groups.emplace_back(offset, static_cast<uint32_t>(count));
+        offset += groupHeader.size();
+        for (const auto& block : blocks) {
+            file.write(block.data(), static_cast<std::streamsize>(block.size()));
+            offset += block.size();
+        }
+    }
+
+    std::string footer;
+    putU32(footer, static_cast<uint32_t>(groups.size()));
+    for (const auto& group : groups) {
+        putU64(footer, group.first);
+        putU32(footer, group.second);
+    }
+    putU64(footer, rows.size());
+    putU64(footer, offset);
+    footer += "USTC";
+    file.write(footer.data(), static_cast<std::streamsize>(footer.size()));
+
+    file.close();
+    if (!file) {
+        error = "Could not write " + path;
+        return false;
+    }
+    return true;
+}
+
+// Encode one column of a chunk of rows into a block: the header, the minimum and maximum, then
+// the values. The string columns with a dictionary in the store are dictionary encoded when that
+// is smaller, the chunk gets its own dictionary of the values it uses
+void Exporter::encodeColumn(const RecordStore& store, const RowId* rows, size_t count, Column column, std::string& block) {
+    std::string body;
+    Encoding encoding = PLAIN;
+
+    if (column == SEVERITY) {
+        uint8_t low = UINT8_MAX, high = 0;
+        for (size_t i = 0; i < count; ++i) {
+            auto severity = static_cast<uint8_t>(store.severity(rows[i]));
+            low = std::min(low, severity);
+            high = std::max(high, severity);
+        }
+        putU8(body, low);
+        putU8(body, high);
+        for (size_t i = 0; i < count; ++i) {
+            putU8(body, static_cast<uint8_t>(store.severity(rows[i])));
+        }
+    } else if (column == DISTANCE) {
+        double low = store.distance(rows[0]), high = low;
+        for (size_t i = 1; i < count; ++i) {
+            low = std::min(low, store.distance(rows[i]));
+            high = std::max(high, store.distance(rows[i]));
+        }
+        putDouble(body, low);
+        putDouble(body, high);
+        for (size_t i = 0; i < count; ++i) {
+            putDouble(body, store.distance(rows[i]));
+        }
+    } else if (column == ID) {
+        std::string_view low = store.id(rows[0]), high = low;
+        for (size_t i = 1; i < count; ++i) {
+            std::string_view id = store.id(rows[i]);
+            low = std::min(low, id);
+            high = std::max(high, id);
+        }
+        putString(body, low);
+        putString(body, high);
+        for (size_t i = 0; i < count; ++i) {
+            putString(body, store.id(rows[i]));
+        }
+    } else {
+        const StringDictionary& dictionary = column == CITY ? store.cities() : column == STATE ? store.states() : store.zipcodes();
+        auto codeOf = [&](RowId row) -> uint32_t {
+            return column == CITY ? store.cityCode(row) : column == STATE ? store.stateCode(row) : store.zipCode(row);
+        };
+
+        //the store codes used by the chunk, numbered in the order they first appear
+        std::unordered_map<uint32_t, uint32_t> chunkCodes;
+        std::vector<uint32_t> entries, codes(count);
+        size_t plainBytes = 0;
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t code = codeOf(rows[i]);
+            plainBytes += 2 + dictionary.value(code).size();
+            auto inserted = chunkCodes.emplace(code, static_cast<uint32_t>(entries.size()));
+            if (inserted.second) {
+                entries.push_back(code);
+            }
+            codes[i] = inserted.first->second;
+        }
+        size_t dictionaryBytes = 4 + 2 * count;
+        std::string_view low = dictionary.value(entries[0]), high = low;
+        for (uint32_t code : entries) {
+            const std::string& value = dictionary.value(code);
+            dictionaryBytes += 2 + value.size();
+            low = std::min<std::string_view>(low, value);
+            high = std::max<std::string_view>(high, value);
+        }
+        putString(body, low);
+        putString(body, high);
+
+        if (entries.size() <= UINT16_MAX + 1 && dictionaryBytes < plainBytes) {
+            encoding = DICTIONARY;
+            putU32(body, static_cast<uint32_t>(entries.size()));
+            for (uint32_t code : entries) {
+                putString(body, dictionary.value(code));
+            }
+            for (size_t i = 0; i < count; ++i) {
+                putU16(body, static_cast<uint16_t>(codes[i]));
+            }
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                putString(body, dictionary.value(entries[codes[i]]));
+            }
+        }
+    }
+
+    putU8(block, static_cast<uint8_t>(column));
+    putU8(block, static_cast<uint8_t>(encoding));
+    putU32(block, static_cast<uint32_t>(body.size()));
+    block += body;
+}
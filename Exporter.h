@@ -0,0 +1,44 @@
+#ifndef US_TRAFFIC_INCIDENTS_EXPORTER_H
+#define US_TRAFFIC_INCIDENTS_EXPORTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "RecordStore.h"
+
+// Writes the rows of a query result to a file for other tools, a path ending in .csv gets CSV
+// and a path ending in .col gets the columnar format below. Both are written in chunks of
+// CHUNK_ROWS rows, so only one chunk is ever held in memory besides the row numbers.
+//
+// Columnar file, every number little-endian:
+//   "USTC", u32 version
+//   per chunk (row group): u32 rows, then one block per column in the order ID, severity,
+//   distance, city, state, zipcode:
+//     u8 column, u8 encoding (0 plain, 1 dictionary), u32 length of the rest of the block,
+//     the minimum and the maximum of the column in the chunk, then the values
+//   footer: u32 row groups, per row group u64 file offset and u32 rows, u64 total rows
+//   u64 offset of the footer, "USTC"
+// Severity is one byte, distance an 8 byte double and a string a u16 length and its bytes.
+// A plain block lists the values of its rows. A dictionary block lists the distinct values
+// (u32 count, then the strings) followed by a u16 code per row; it is used for a string column
+// when it takes fewer bytes than the plain block. The blocks of a chunk are encoded in parallel
+class Exporter {
+public:
+    enum Format { CSV, COLUMNAR };
+    enum Column { ID, SEVERITY, DISTANCE, CITY, STATE, ZIPCODE, COLUMN_COUNT };
+    enum Encoding { PLAIN, DICTIONARY };
+
+    static constexpr size_t CHUNK_ROWS = 65536;
+    static constexpr uint32_t VERSION = 1;
+
+    static bool formatOf(const std::string& path, Format& format);
+    static bool write(const RecordStore& store, const std::vector<RowId>& rows, const std::string& path, std::string& error);
+
+private:
+    static bool writeCsv(const RecordStore& store, const std::vector<RowId>& rows, const std::string& path, std::string& error);
+    static bool writeColumnar(const RecordStore& store, const std::vector<RowId>& rows, const std::string& path, std::string& error);
+    static void encodeColumn(const RecordStore& store, const RowId* rows, size_t count, Column column, std::string& block);
+};
+
+#endif //US_TRAFFIC_INCIDENTS_EXPORTER_H
@@ -0,0 +1,161 @@
+#include "GroupBy.h"
+#include <algorithm>
+#include <unordered_map>
+#include "Parallel.h"
+#include "TopK.h"
+
+// Bitmap words (64 rows each) in a morsel of the scheduler, 16K rows
+constexpr size_t MORSEL_WORDS = 256;
+
+// Aggregate with a private array of totals per thread, the key must be below domain
+template <typename KeyOf>
+static std::vector<Group> aggregateDirect(const RecordStore& store, const RowBitmap& rows, size_t domain, KeyOf keyOf) {
+    const uint64_t* words = rows.data();
+    std::vector<std::vector<Aggregate>> partial(workerCount());
+
+    parallelFor(rows.wordCount(), MORSEL_WORDS, [&](size_t begin, size_t end, unsigned worker) {
+        std::vector<Aggregate>& totals = partial[worker];
+        totals.resize(domain);
+        for (size_t w = begin; w < end; ++w) {
+            for (uint64_t word = words[w]; word != 0; word &= word - 1) {
+                auto row = static_cast<RowId>(w * 64 + __builtin_ctzll(word));
+                totals[keyOf(row)].addRecord(store.severity(row), store.distance(row));
+            }
+        }
+    });
+
+    std::vector<Aggregate> merged(domain);
+    for (const auto& totals : partial) {
+        for (size_t key = 0; key < totals.size(); ++key) {
+            if (totals[key].count > 0) {
+                merged[key].add(totals[key]);
+            }
+        }
+    }
+    std::vector<Group> groups;
+    for (size_t key = 0; key < domain; ++key) {
+        if (merged[key].count > 0) {
+            groups.push_back({static_cast<uint32_t>(key), merged[key]});
+        }
+    }
+    return groups;
+}
+
+// Aggregate with a private hash map per thread, for keys with many distinct values
+template <typename KeyOf>
+static std::vector<Group> aggregateHashed(const RecordStore& store, const RowBitmap& rows, KeyOf keyOf) {
+    const uint64_t* words = rows.data();
+    std::vector<std::unordered_map<uint32_t, Aggregate>> partial(workerCount());
+
+    parallelFor(rows.wordCount(), MORSEL_WORDS, [&](size_t begin, size_t end, unsigned worker) {
+        auto& totals = partial[worker];
+        for (size_t w = begin; w < end; ++w) {
+            for (uint64_t word = words[w]; word != 0; word &= word - 1) {
+                auto row = static_cast<RowId>(w * 64 + __builtin_ctzll(word));
+                totals[keyOf(row)].addRecord(store.severity(row), store.distance(row));
+            }
+        }
+    });
+
+    std::unordered_map<uint32_t, Aggregate> merged = std::move(partial[0]);
+    for (size_t i = 1; i < partial.size(); ++i) {
+        for (const auto& entry : partial[i]) {
+            merged[entry.first].add(entry.second);
+        }
+    }
+    std::vector<Group> groups;
+    groups.reserve(merged.size());
+    for (const auto& entry : merged) {
+        groups.push_back({entry.first, entry.second});
+    }
+    return groups;
+}
+
+// Pick the array or the hash map depending on how many distinct keys there can be
+template <typename KeyOf>
+static std::vector<Group> aggregate(const RecordStore& store, const RowBitmap& rows, size_t domain, KeyOf keyOf) {
+    if (domain <= GroupBy::DIRECT_LIMIT) {
+        return aggregateDirect(store, rows, domain, keyOf);
+    }
+    return aggregateHashed(store, rows, keyOf);
+}
+
+// Distance is a measure, not a key
+bool GroupBy::canGroupBy(AccidentFilter::Field field) {
+    return field != AccidentFilter::DISTANCE;
+}
+
+// Larger groups rank first, groups of the same size in key order
+bool GroupBy::ranksBefore(const Group& a, const Group& b) {
+    return a.totals.count != b.totals.count ? a.totals.count > b.totals.count : a.key < b.key;
+}
+
+// Group the selected rows by the field, the largest groups come first. A limit keeps only that
+// many of the largest groups, picked with a bounded heap instead of sorting them all
+std::vector<Group> GroupBy::run(const RecordStore& store, const RowBitmap& rows, AccidentFilter::Field field, size_t limit) {
+    std::vector<Group> groups;
+    switch (field) {
+        case AccidentFilter::SEVERITY:
+            groups = aggregate(store, rows, 256, [&store](RowId row) { return static_cast<uint32_t>(store.severity(row)); });
+            break;
+        case AccidentFilter::CITY:
+            groups = aggregate(store, rows, store.cities().size(), [&store](RowId row) { return store.cityCode(row); });
+            break;
+        case AccidentFilter::STATE:
+            groups = aggregate(store, rows, store.states().size(), [&store](RowId row) { return static_cast<uint32_t>(store.stateCode(row)); });
+            break;
+        case AccidentFilter::ZIPCODE:
+            groups = aggregate(store, rows, store.zipcodes().size(), [&store](RowId row) { return store.zipCode(row); });
+            break;
+        case AccidentFilter::DISTANCE:
+            return groups;
+    }
+    if (limit > 0 && limit < groups.size()) {
+        return TopK::largest(groups, limit);
+    }
+    std::sort(groups.begin(), groups.end(), ranksBefore);
+    return groups;
+}
+
+// Text of a group key
+std::string GroupBy::keyName(const RecordStore& store, AccidentFilter::Field field, uint32_t key) {
+    switch (field) {
+        case AccidentFilter::SEVERITY: return std::to_string(key);
+        case AccidentFilter::CITY: return store.cities().value(key);
+        case AccidentFilter::STATE: return store.states().value(key);
+        case AccidentFilter::ZIPCODE: return store.zipcodes().value(key);
+        case AccidentFilter::DISTANCE: break;
+    }
+    return "";
+}
+
+// Name of a field as it is written in a query
+const char* GroupBy::fieldName(AccidentFilter::Field field) {
+    switch (field) {
+        case AccidentFilter::SEVERITY: return "severity";
+        case AccidentFilter::CITY: return "city";
+        case AccidentFilter::STATE: return "state";
+        case AccidentFilter::ZIPCODE: return "zipcode";
+        case AccidentFilter::DISTANCE: return "distance";
+    }
+    return "";
+}
+
+// Name of a field as the menus print it
+const char* GroupBy::fieldLabel(AccidentFilter::Field field) {
+    switch (field) {
+        case AccidentFilter::SEVERITY: return "Severity";
+        case AccidentFilter::CITY: return "City";
+        case AccidentFilter::STATE: return "State";
+        case AccidentFilter::ZIPCODE: return "Zipcode";
+        case AccidentFilter::DISTANCE: return "Distance";
+    }
+    return "";
+}
+
+// Print a group in the same format used by the query menu
+void GroupBy::print(const RecordStore& store, AccidentFilter::Field field, const Group& group, std::ostream& out) {
+    out << fieldLabel(field) << ": " << keyName(store, field, group.key) << ", Count: " << group.totals.count
+        << ", Total Distance: " << group.totals.distanceSum << ", Average Distance: " << group.totals.distanceAverage()
+        << ", Min Distance: " << group.totals.distanceMin << ", Max Distance: " << group.totals.distanceMax << '\n';
+}
@@ -0,0 +1,35 @@
+#ifndef US_TRAFFIC_INCIDENTS_GROUPBY_H
+#define US_TRAFFIC_INCIDENTS_GROUPBY_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "RecordStore.h"
+#include "RowBitmap.h"
+#include "AccidentFilter.h"
+#include "Aggregate.h"
+
+// One group of a group-by: the key (the severity itself, or the dictionary code of the city,
+// state or zipcode) and the count, distance sum, minimum and maximum of its rows
+struct Group {
+    uint32_t key;
+    Aggregate totals;
+};
+
+// Hash aggregation over the selected rows of the store. Every thread aggregates the morsels of the
+// row bitmap it takes into private totals and the partial results are merged at the end. Keys with a
+// small domain (severity, state) are counted in arrays indexed by the key instead of a hash map
+class GroupBy {
+public:
+    static constexpr size_t DIRECT_LIMIT = 4096;
+
+    static bool canGroupBy(AccidentFilter::Field field);
+    static bool ranksBefore(const Group& a, const Group& b);
+    static std::vector<Group> run(const RecordStore& store, const RowBitmap& rows, AccidentFilter::Field field, size_t limit = 0);
+    static std::string keyName(const RecordStore& store, AccidentFilter::Field field, uint32_t key);
+    static const char* fieldName(AccidentFilter::Field field);
+    static const char* fieldLabel(AccidentFilter::Field field);
+    static void print(const RecordStore& store, AccidentFilter::Field field, const Group& group, std::ostream& out);
+};
+
+#endif //US_TRAFFIC_INCIDENTS_GROUPBY_H
@@ -1,18 +1,19 @@
 #include "Hash_table.h"
+#include <algorithm>
 #include <iostream>
 
 using namespace std;
 
-// Constructor
-HashTable::HashTable(int buckets) : numBuckets(buckets), size(0) {
+// Constructor, the table indexes rows of the given store
+HashTable::HashTable(RecordStore& store, int buckets) : store(&store), numBuckets(buckets), size(0) {
     table.resize(numBuckets);
 }
 
-// Hash function, it uses the hash<string> object that converts a string into a hash value
-// it is then module by the number of buckets to generate the final index value.
-int HashTable::hashFunction(const string& key) const {
-    hash<string> HASH;
-    return HASH(key) % numBuckets;
+// Hash function, it uses the hash<string_view> object that converts a string into a hash value
+// the full value is kept in the bucket, it is module by the number of buckets to get the index.
+// The ID filter takes the same value
+size_t HashTable::hashFunction(std::string_view key) {
+    return IdFilter::hash(key);
 }
 
 // Resize function and doubles the size of the table. it does not check the LoadFactor
@@ -25,8 +26,8 @@ void HashTable::resize() {
     //iterates over the old table and get the new hash values
     for (const auto& accident : table) {
         if (accident.isOccupied && !accident.isDeleted) {
-            std::hash<std::string> HASH;
-            int index = HASH(accident.accident.ID) % newNumBuckets;
+            //the bucket remembers the hash, so the IDs don't need to be hashed again
+            int index = accident.hash % newNumBuckets;
 
             //probing
             while (newTable[index].isOccupied) {
@@ -42,16 +43,35 @@ void HashTable::resize() {
     numBuckets = newNumBuckets;
 }
 
-// Insert function, inserts an accident on the table at its calculated hash index
+// Refill the ID filter, sized for the given number of IDs, from the hashes kept in the buckets.
+// Done after many removes or once the table outgrew it
+void HashTable::rebuildFilter(size_t ids) {
+    idFilter.reset(ids);
+    for (const auto& bucket : table) {
+        if (bucket.isOccupied && !bucket.isDeleted) {
+            idFilter.add(bucket.hash);
+        }
+    }
+}
+
+// Insert function, adds the accident to the store and inserts its row on the table
 void HashTable::insert(const TrafficAccident& accident) {
+    RowId row = store->append(accident);
+    if (row != NO_ROW) {
+        insertRow(row);
+    }
+}
 
+// Insert a row that is already in the store at its calculated hash index
+void HashTable::insertRow(RowId row) {
     //first, check if the load factor is >= to 0.8 then resize
     if (size >= numBuckets * 0.8) {
         resize();
     }
 
     // find the index of this new data
-    int index = hashFunction(accident.ID);
+    size_t hash = hashFunction(store->id(row));
+    int index = hash % numBuckets;
     int originalIndex = index;
 
     //probing, if the
@@ -64,30 +84,57 @@ void HashTable::insert(const TrafficAccident& accident) {
             return;
         }
     }
+    ++version;
 
-    //insert the accident on the index, and mark that index as occupied and not deleted
-    table[index].accident = accident;
+    //insert the row on the index, and mark that index as occupied and not deleted
+    table[index].hash = hash;
+    table[index].row = row;
     table[index].isOccupied = true;
     table[index].isDeleted = false;
 
-    //update the size
+    //update the size and remember the row is part of this table
     ++size;
+    if (members.size() <= row) {
+        members.resize(store->size());
+    }
+    members.set(row);
+    uint32_t city = store->cityCode(row);
+    if (cityRows.size() <= city) {
+        cityRows.resize(store->cities().size());
+    }
+    ++cityRows[city];
+    idFilter.add(hash);
+    if (idFilter.needsRebuild()) {
+        rebuildFilter(2 * static_cast<size_t>(size));
+    }
 }
 
 // Remove function, removes a specified accident by its ID
 void HashTable::remove(const std::string& id) {
-
     //get the index of the ID
-    int index = hashFunction(id);
+    size_t hash = hashFunction(id);
+    int index = hash % numBuckets;
     int originalIndex = index;
+    if (!idFilter.mayContain(hash)) {
+        return;
+    }
 
     //Just search on the occupied places
     while (table[index].isOccupied) {
 
         //if the index is not deleted and is the value desired to remove, then mark it as deleted
-        if (!table[index].isDeleted && table[index].accident.ID == id) {
+        //(the row stays in the store, it is just no longer part of this table)
+        if (!table[index].isDeleted && table[index].hash == hash && store->id(table[index].row) == id) {
+            ++version;
             table[index].isDeleted = true;
+            members.reset(table[index].row);
+            --cityRows[store->cityCode(table[index].row)];
             --size;
+            //the filter still holds the ID, it is rebuilt once too many of its IDs are gone
+            idFilter.noteRemove();
+            if (idFilter.needsRebuild()) {
+                rebuildFilter(2 * static_cast<size_t>(size));
+            }
             return;
         }
 
@@ -104,16 +151,10 @@ void HashTable::remove(const std::string& id) {
 }
 
 //Display function, to display all the table, no much explanation
-void HashTable::display() const {
+void HashTable::display(OutputWriter& out) const {
     for (int i = 0; i < numBuckets; ++i) {
         if (table[i].isOccupied && !table[i].isDeleted) {
-            const auto& acc = table[i].accident;
-            cout << "ID: " << acc.ID
-                 << ", Severity: " << acc.severity
-                 << ", Distance: " << acc.distance
-                 << ", City: " << acc.city
-                 << ", State: " << acc.state
-                 << ", Zipcode: " << acc.zipcode << std::endl;
+            out.row(*store, table[i].row);
         }
     }
 }
@@ -123,16 +164,26 @@ bool HashTable::isEmpty() const {
     return size == 0;
 }
 
-//searches an accident by its ID and returns tha accident as a TrafficAccident* object
-TrafficAccident* HashTable::searchByID(const std::string& id) {
+//searches an accident by its ID and returns its row in the store, the ID filter turns away most
+//IDs that are not in the table, and the stored hash is compared first so only a real match has to
+//look at the ID column
+RowId HashTable::searchByID(const std::string& id) const {
+    size_t hash = hashFunction(id);
+    if (!idFilter.mayContain(hash)) {
+        return NO_ROW;
+    }
+    return probe(id, hash);
+}
 
-    int index = hashFunction(id);
+// Probe the table for an ID whose hash is already computed
+RowId HashTable::probe(const std::string& id, size_t hash) const {
+    int index = hash % numBuckets;
     int originalIndex = index;
 
     //Iterating over the table to find a match
     while (table[index].isOccupied) {
-        if (!table[index].isDeleted && table[index].accident.ID == id) {
-            return &table[index].accident;
+        if (!table[index].isDeleted && table[index].hash == hash && store->id(table[index].row) == id) {
+            return table[index].row;
         }
         //probing to go to the next value
         index = (index + 1) % numBuckets;
@@ -142,58 +193,88 @@ TrafficAccident* HashTable::searchByID(const std::string& id) {
             break;
         }
     }
-    //If no accident found return a null pointer
-    return nullptr;
+    //If no accident found return NO_ROW
+    return NO_ROW;
 }
 
-//searches all the accidents with a specified severity and returns a hash table with all the values
-HashTable HashTable::searchBySeverity(int severity) const {
-    HashTable result(numBuckets);
-
-    //iterate over the whole table if the accident matches the severity then insert it into this new table
-    for (const auto& entry : table) {
-        if (entry.isOccupied && !entry.isDeleted && entry.accident.severity == severity) {
-            result.insert(entry.accident);
+// Look up many IDs at once, rows[i] is the row of ids[i] or NO_ROW. The IDs go by groups: the
+// hashes of a group are computed and their filter blocks prefetched, then the home buckets of the
+// IDs the filter lets through, then the ID of the row in each bucket, and only then is each ID
+// probed, so the cache misses of the group overlap instead of coming one after the other as they
+// do with searchByID in a loop
+void HashTable::multiGet(const std::vector<std::string>& ids, std::vector<RowId>& rows) const {
+    constexpr size_t GROUP = 16;
+    size_t hashes[GROUP];
+    bool present[GROUP];
+    rows.assign(ids.size(), NO_ROW);
+
+    for (size_t first = 0; first < ids.size(); first += GROUP) {
+        size_t count = std::min(GROUP, ids.size() - first);
+        for (size_t i = 0; i < count; ++i) {
+            hashes[i] = hashFunction(ids[first + i]);
+            prefetch(idFilter.blockOf(hashes[i]));
+        }
+        for (size_t i = 0; i < count; ++i) {
+            present[i] = idFilter.mayContain(hashes[i]);
+            if (present[i]) {
+                prefetch(&table[hashes[i] % numBuckets]);
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            const Buckets& home = table[hashes[i] % numBuckets];
+            if (present[i] && home.isOccupied && home.hash == hashes[i]) {
+                store->prefetchId(home.row);
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (present[i]) {
+                rows[first + i] = probe(ids[first + i], hashes[i]);
+            }
         }
     }
-    return result;
+}
+
+//searches all the accidents with a specified severity and returns a hash table with all the values
+HashTable HashTable::searchBySeverity(int severity) const {
+    AccidentFilter byField;
+    byField.requireSeverity(severity);
+    byField.compile(*store);
+    return filter(byField);
 }
 
 //searches all the accidents in a specified city and returns a hash table with all the values
 HashTable HashTable::searchByCity(const std::string& city) const {
-    HashTable result(numBuckets);
-
-    //iterate over the whole table if the accident matches the city then insert it into this new table
-    for (const auto& entry : table) {
-        if (entry.isOccupied && !entry.isDeleted && entry.accident.city == city) {
-            result.insert(entry.accident);
-        }
-    }
-    return result;
+    AccidentFilter byField;
+    byField.requireCity(city);
+    byField.compile(*store);
+    return filter(byField);
 }
 
 //searches all the accidents in a specified state and returns a hash table with all the values
 HashTable HashTable::searchByState(const std::string& state) const {
-    HashTable result(numBuckets);
-
-    //iterate over the whole table if the accident matches the state then insert it into this new table
-    for (const auto& entry : table) {
-        if (entry.isOccupied && !entry.isDeleted && entry.accident.state == state) {
-            result.insert(entry.accident);
-        }
-    }
-    return result;
+    AccidentFilter byField;
+    byField.requireState(state);
+    byField.compile(*store);
+    return filter(byField);
 }
 
 //searches all the accidents in a specified zone by its zipcode and returns a hash table with all the values
 HashTable HashTable::searchByZipcode(const std::string& zipcode) const {
-    HashTable result(numBuckets);
+    AccidentFilter byField;
+    byField.requireZipcode(zipcode);
+    byField.compile(*store);
+    return filter(byField);
+}
 
-    //iterate over the whole table if the accident matches the zipcode then insert it into this new table
-    for (const auto& entry : table) {
-        if (entry.isOccupied && !entry.isDeleted && entry.accident.zipcode == zipcode) {
-            result.insert(entry.accident);
-        }
+//keeps the accidents that match all the predicates of a compiled filter, the predicates run as
+//column scans over the rows of this table and the matching rows are inserted into the new table
+HashTable HashTable::filter(const AccidentFilter& filter) const {
+    HashTable result(*store, numBuckets);
+
+    RowBitmap selected = members;
+    filter.select(*store, selected);
+    for (RowId row : selected.rows()) {
+        result.insertRow(row);
     }
     return result;
 }
@@ -203,6 +284,21 @@ int HashTable::getSize() const {
     return size;
 }
 
+// Get the version of the table, it changes with every insert and remove
+uint64_t HashTable::getVersion() const {
+    return version;
+}
+
+// Get the rows of the store that are in the table
+const RowBitmap& HashTable::getMembers() const {
+    return members;
+}
+
+// Number of rows of this table in each city, indexed by city code, codes past the end have none
+const std::vector<uint32_t>& HashTable::getCityRows() const {
+    return cityRows;
+}
+
 // Get the number of buckets in the hash table
 int HashTable::getBucketCount() const {
     return numBuckets;
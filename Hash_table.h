@@ -1,41 +1,66 @@
+#ifndef US_TRAFFIC_INCIDENTS_HASH_TABLE_H
+#define US_TRAFFIC_INCIDENTS_HASH_TABLE_H
+
 #include <string>
 #include <vector>
 #include "TrafficAccident.h"
+#include "RecordStore.h"
+#include "RowBitmap.h"
+#include "AccidentFilter.h"
+#include "OutputWriter.h"
+#include "IdFilter.h"
 
 using namespace std;
 
-//struct containing the data for each bucket in the hash table
+//struct containing the data for each bucket in the hash table, the accident itself lives in the
+//RecordStore and the bucket keeps its row number plus the full hash of its ID
 struct Buckets {
-    TrafficAccident accident;
+    size_t hash;
+    RowId row;
     bool isOccupied;
     bool isDeleted;
 
-    Buckets() : isOccupied(false), isDeleted(false) {}
+    Buckets() : hash(0), row(NO_ROW), isOccupied(false), isDeleted(false) {}
 };
 
 class HashTable {
 private:
 
+    RecordStore* store;
     std::vector<Buckets> table;
     int numBuckets;
     int size;
+    RowBitmap members; // rows of the store that are in this table
+    std::vector<uint32_t> cityRows; // rows of this table per city code, ranks the city suggestions
+    uint64_t version = 0; // bumped by every insert and remove that succeeds, cached query results check it
+    IdFilter idFilter; // rejects most IDs that are not in the table before any bucket is probed
 
-    int hashFunction(const std::string& key) const;
+    static size_t hashFunction(std::string_view key);
+    RowId probe(const std::string& id, size_t hash) const;
+    void rebuildFilter(size_t ids);
 
 public:
-    HashTable(int buckets = 101);
+    HashTable(RecordStore& store, int buckets = 101);
     void resize();
     void insert(const TrafficAccident& accident);
+    void insertRow(RowId row);
     void remove(const std::string& id);
-    void display() const;
+    void display(OutputWriter& out) const;
     bool isEmpty() const;
-    TrafficAccident* searchByID(const std::string& id);
+    RowId searchByID(const std::string& id) const;
+    void multiGet(const std::vector<std::string>& ids, std::vector<RowId>& rows) const;
     HashTable searchBySeverity(int severity) const;
     HashTable searchByCity(const std::string& city) const;
     HashTable searchByState(const std::string& state) const;
     HashTable searchByZipcode(const std::string& zipcode) const;
+    HashTable filter(const AccidentFilter& filter) const;
     int getSize() const;
+    uint64_t getVersion() const;
+    const RowBitmap& getMembers() const;
+    const std::vector<uint32_t>& getCityRows() const;
     int getBucketCount() const;
     int getBucketSize(int index) const;
     float getLoadFactor() const;
-};
\ No newline at end of file
+};
+
+#endif //US_TRAFFIC_INCIDENTS_HASH_TABLE_H
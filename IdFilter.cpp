@@ -0,0 +1,15 @@
+#include "IdFilter.h"
+
+// Empty the filter and size it for the given number of IDs, at least MIN_IDS. The block count is a
+// power of two
+void IdFilter::reset(size_t ids) {
+    capacity = ids > MIN_IDS ? ids : MIN_IDS;
+    size_t count = 1;
+    while (count * 512 < capacity * BITS_PER_ID) {
+        count *= 2;
+    }
+    blocks.assign(count, Block{});
+    mask = count - 1;
+    added = 0;
+    removed = 0;
+}
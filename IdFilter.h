@@ -0,0 +1,71 @@
+#ifndef US_TRAFFIC_INCIDENTS_IDFILTER_H
+#define US_TRAFFIC_INCIDENTS_IDFILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+// Blocked Bloom filter of the IDs an index holds, so the lookup of an ID that is not there is
+// answered from one cache line instead of a probe chain or a descent of a tree. An ID picks one
+// 64 byte block and sets a bit in each of its 8 words; mayContain() is never false for an ID that
+// was added. Removed IDs cannot be taken out, the owner counts them with noteRemove() and
+// rebuilds the filter from its live IDs once needsRebuild() says so, which is also the case when
+// more IDs were added than it was sized for. The owner sizes it for twice its IDs when it rebuilds,
+// so an index that keeps growing rebuilds it only each time it doubles
+class IdFilter {
+public:
+    static constexpr size_t BITS_PER_ID = 16;
+    static constexpr size_t MIN_IDS = 1024;
+
+    IdFilter() { reset(0); }
+
+    static size_t hash(std::string_view id) { return std::hash<std::string_view>()(id); }
+
+    void reset(size_t ids);
+
+    void add(size_t hash) {
+        uint64_t* words = blocks[blockIndex(hash)].words;
+        uint32_t bits = static_cast<uint32_t>(mix(hash));
+        for (int i = 0; i < 8; ++i) {
+            words[i] |= uint64_t(1) << (bits * SALT[i] >> 26);
+        }
+        ++added;
+    }
+
+    bool mayContain(size_t hash) const {
+        const uint64_t* words = blocks[blockIndex(hash)].words;
+        uint32_t bits = static_cast<uint32_t>(mix(hash));
+        bool found = true;
+        for (int i = 0; i < 8; ++i) {
+            found &= (words[i] >> (bits * SALT[i] >> 26) & 1) != 0;
+        }
+        return found;
+    }
+
+    const void* blockOf(size_t hash) const { return &blocks[blockIndex(hash)]; }
+    void noteRemove() { ++removed; }
+    bool needsRebuild() const { return added > capacity || removed > added / 2; }
+    size_t getCapacity() const { return capacity; }
+
+private:
+    struct alignas(64) Block {
+        uint64_t words[8];
+    };
+
+    static constexpr uint32_t SALT[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                         0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+    std::vector<Block> blocks;
+    size_t mask = 0;
+    size_t capacity = 0; // IDs the filter was sized for
+    size_t added = 0;    // IDs added since the last reset, removed ones included
+    size_t removed = 0;  // IDs removed from the owner since the last reset
+
+    //the hash also picks the bucket of the hash table, it is remixed so the two do not line up
+    static uint64_t mix(size_t hash) { return static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL; }
+    size_t blockIndex(size_t hash) const { return static_cast<size_t>(mix(hash) >> 32) & mask; }
+};
+
+#endif //US_TRAFFIC_INCIDENTS_IDFILTER_H
@@ -0,0 +1,195 @@
+// Load generator for the query server: every client thread connects to the server socket and sends
+// the commands of a file, a window of pipelined commands at a time (one by default), waiting for
+// the answers of a window before sending the next. Then the throughput and the latency percentiles
+// of all the requests are printed. Only needs POSIX sockets
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Latencies and errors of one client
+struct ClientStats {
+    std::vector<double> latencies;
+    size_t errors = 0;
+    bool connected = false;
+};
+
+// Connect to the server socket, -1 when it cannot be reached
+int connectTo(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path))
+        return -1;
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Send the whole text, false when the server closed the connection
+bool sendAll(int fd, const std::string& text) {
+    size_t sent = 0;
+    while (sent < text.size()) {
+        ssize_t written = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0)
+            return false;
+        sent += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// Read up to the OK or ERROR line that ends an answer, ok tells which one it was. Bytes read past
+// it stay in the buffer for the next answer
+bool readAnswer(int fd, std::string& buffer, bool& ok) {
+    size_t start = 0;
+    char chunk[64 * 1024];
+    while (true) {
+        size_t end;
+        while ((end = buffer.find('\n', start)) != std::string::npos) {
+            bool isOk = buffer.compare(start, 3, "OK ") == 0;
+            if (isOk || buffer.compare(start, 6, "ERROR ") == 0) {
+                ok = isOk;
+                buffer.erase(0, end + 1);
+                return true;
+            }
+            start = end + 1;
+        }
+        ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+        if (received <= 0)
+            return false;
+        buffer.append(chunk, static_cast<size_t>(received));
+    }
+}
+
+// One client: requests commands, starting at its own offset in the list so the clients do not all
+// send the same command at the same time. The latency of a request runs from the sending of its
+// window to its answer
+void runClient(const std::string& path, const std::vector<std::string>& commands, size_t requests, size_t pipeline,
+               size_t offset, ClientStats& stats) {
+    int fd = connectTo(path);
+    if (fd < 0)
+        return;
+    stats.connected = true;
+    stats.latencies.reserve(requests);
+    std::string buffer, window;
+    for (size_t i = 0; i < requests; i += pipeline) {
+        size_t count = std::min(pipeline, requests - i);
+        window.clear();
+        for (size_t j = 0; j < count; ++j) {
+            window += commands[(offset + i + j) % commands.size()];
+            window += '\n';
+        }
+        auto start = std::chrono::steady_clock::now();
+        if (!sendAll(fd, window)) {
+            ++stats.errors;
+            break;
+        }
+        for (size_t j = 0; j < count; ++j) {
+            bool ok = false;
+            if (!readAnswer(fd, buffer, ok)) {
+                ++stats.errors;
+                close(fd);
+                return;
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            stats.latencies.push_back(elapsed.count());
+            if (!ok) {
+                ++stats.errors;
+            }
+        }
+    }
+    close(fd);
+}
+
+// Latency below which the given share of the sorted latencies fall
+double percentile(const std::vector<double>& sorted, double fraction) {
+    if (sorted.empty())
+        return 0.0;
+    auto rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+    return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+// Read a positive whole number argument, 0 when it is not one
+size_t readCount(const char* text) {
+    char* end = nullptr;
+    long long value = std::strtoll(text, &end, 10);
+    return end != text && *end == '\0' && value > 0 ? static_cast<size_t>(value) : 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3 || argc > 6) {
+        std::cout << "Usage: " << argv[0] << " <socket> <file with one command per line> [clients, default 4]"
+                  << " [requests per client, default 10000] [pipelined requests, default 1]" << std::endl;
+        return 1;
+    }
+    std::string path = argv[1];
+    size_t clients = argc > 3 ? readCount(argv[3]) : 4;
+    size_t requests = argc > 4 ? readCount(argv[4]) : 10000;
+    size_t pipeline = argc > 5 ? readCount(argv[5]) : 1;
+    if (clients == 0 || requests == 0 || pipeline == 0) {
+        std::cout << "Error: The number of clients, of requests and of pipelined requests must be positive whole numbers" << std::endl;
+        return 1;
+    }
+
+    std::ifstream file(argv[2]);
+    if (!file.is_open()) {
+        std::cout << "Error: Could not open the command file " << argv[2] << std::endl;
+        return 1;
+    }
+    std::vector<std::string> commands;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        size_t first = line.find_first_not_of(" \t");
+        if (first != std::string::npos && line[first] != '#') {
+            commands.push_back(line);
+        }
+    }
+    if (commands.empty()) {
+        std::cout << "Error: The command file has no commands" << std::endl;
+        return 1;
+    }
+
+    std::vector<ClientStats> stats(clients);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < clients; ++c) {
+        threads.emplace_back(runClient, std::cref(path), std::cref(commands), requests, pipeline, c * commands.size() / clients, std::ref(stats[c]));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::vector<double> latencies;
+    size_t errors = 0, connected = 0;
+    for (const auto& client : stats) {
+        latencies.insert(latencies.end(), client.latencies.begin(), client.latencies.end());
+        errors += client.errors;
+        connected += client.connected ? 1 : 0;
+    }
+    if (connected == 0) {
+        std::cout << "Error: Could not connect to " << path << std::endl;
+        return 1;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "Clients: " << connected << ", Requests: " << latencies.size() << ", Errors: " << errors
+              << ", Total Time: " << elapsed.count() << "s, QPS: " << latencies.size() / elapsed.count() << std::endl;
+    std::cout << "Latency p50: " << percentile(latencies, 0.5) << "s, p90: " << percentile(latencies, 0.9)
+              << "s, p99: " << percentile(latencies, 0.99) << "s, Max: " << percentile(latencies, 1.0) << "s" << std::endl;
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,216 @@
+#include "OutputWriter.h"
+#include <charconv>
+#include <cstring>
+#include "RecordStore.h"
+
+// Buffer of the last writer that ended on this thread, handed to the next one
+static thread_local std::vector<char> spareBuffer;
+
+// Longest formatted number: a double in the shortest round-trip form or a 64-bit integer
+constexpr size_t NUMBER_BYTES = 32;
+
+OutputWriter::OutputWriter(std::ostream& out, Format format) : out(&out), format(format) {
+    buffer.swap(spareBuffer);
+    buffer.resize(BUFFER_SIZE);
+}
+
+OutputWriter::~OutputWriter() {
+    flush();
+    if (spareBuffer.empty()) {
+        buffer.swap(spareBuffer);
+    }
+}
+
+// Format named text, csv, jsonl (or json) or binary
+bool OutputWriter::parseFormat(const std::string& name, Format& format) {
+    if (name == "text") {
+        format = TEXT;
+    } else if (name == "csv") {
+        format = CSV;
+    } else if (name == "jsonl" || name == "json") {
+        format = JSON_LINES;
+    } else if (name == "binary") {
+        format = BINARY;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* OutputWriter::formatName(Format format) {
+    switch (format) {
+        case TEXT: return "text";
+        case CSV: return "csv";
+        case JSON_LINES: return "jsonl";
+        case BINARY: return "binary";
+    }
+    return "";
+}
+
+// What goes before the rows: the column names for CSV, the magic bytes for binary
+void OutputWriter::header() {
+    if (format == CSV) {
+        text("ID,Severity,Distance,City,State,Zipcode\n");
+    } else if (format == BINARY) {
+        text("USTA");
+    }
+}
+
+// One row of the store in the format of the writer
+void OutputWriter::row(const RecordStore& store, RowId row) {
+    ++rows;
+    std::string_view id = store.id(row), city = store.city(row), state = store.state(row), zipcode = store.zipcode(row);
+    if (format == TEXT) {
+        reserve(id.size() + city.size() + state.size() + zipcode.size() + 64 + NUMBER_BYTES);
+        put("ID: ");
+        put(id);
+        put(", Severity: ");
+        putInteger(store.severity(row));
+        put(", Distance: ");
+        putDistance(store.distance(row));
+        put(", City: ");
+        put(city);
+        put(", State: ");
+        put(state);
+        put(", Zipcode: ");
+        put(zipcode);
+        put('\n');
+    } else if (format == CSV) {
+        //quoting can double every character of a field
+        reserve(2 * (id.size() + city.size() + state.size() + zipcode.size()) + 16 + 2 * NUMBER_BYTES);
+        putCsv(id);
+        put(',');
+        putInteger(store.severity(row));
+        put(',');
+        putDistance(store.distance(row));
+        put(',');
+        putCsv(city);
+        put(',');
+        putCsv(state);
+        put(',');
+        putCsv(zipcode);
+        put('\n');
+    } else if (format == JSON_LINES) {
+        //an escaped control character takes 6 bytes
+        reserve(6 * (id.size() + city.size() + state.size() + zipcode.size()) + 96 + 2 * NUMBER_BYTES);
+        put("{\"id\":");
+        putJson(id);
+        put(",\"severity\":");
+        putInteger(store.severity(row));
+        put(",\"distance\":");
+        putDistance(store.distance(row));
+        put(",\"city\":");
+        putJson(city);
+        put(",\"state\":");
+        putJson(state);
+        put(",\"zipcode\":");
+        putJson(zipcode);
+        put("}\n");
+    } else {
+        reserve(id.size() + city.size() + state.size() + zipcode.size() + 8 + 9);
+        putBinary(id);
+        put(static_cast<char>(store.severity(row)));
+        double distance = store.distance(row);
+        std::memcpy(buffer.data() + used, &distance, sizeof(distance));
+        used += sizeof(distance);
+        putBinary(city);
+        putBinary(state);
+        putBinary(zipcode);
+    }
+}
+
+// Text written as it is between the rows, such as a message
+void OutputWriter::text(std::string_view text) {
+    if (text.size() > buffer.size()) {
+        flush();
+        out->write(text.data(), static_cast<std::streamsize>(text.size()));
+        return;
+    }
+    reserve(text.size());
+    put(text);
+}
+
+// Hand the buffered bytes to the stream and flush it
+void OutputWriter::flush() {
+    if (used > 0) {
+        out->write(buffer.data(), static_cast<std::streamsize>(used));
+        used = 0;
+    }
+    out->flush();
+}
+
+// Make room for bytes more, writing the buffer out when they do not fit. A row never needs more
+// than the buffer: the strings of the store are far shorter
+void OutputWriter::reserve(size_t bytes) {
+    if (used + bytes > buffer.size()) {
+        out->write(buffer.data(), static_cast<std::streamsize>(used));
+        used = 0;
+        if (bytes > buffer.size()) {
+            buffer.resize(bytes);
+        }
+    }
+}
+
+void OutputWriter::put(std::string_view text) {
+    std::memcpy(buffer.data() + used, text.data(), text.size());
+    used += text.size();
+}
+
+void OutputWriter::putInteger(long long value) {
+    used = std::to_chars(buffer.data() + used, buffer.data() + used + NUMBER_BYTES, value).ptr - buffer.data();
+}
+
+// The text format prints 6 significant digits like a stream does, the data formats the shortest
+// form that reads back as the same double
+void OutputWriter::putDistance(double value) {
+    char* first = buffer.data() + used;
+    char* last = first + NUMBER_BYTES;
+    if (format == TEXT) {
+        used = std::to_chars(first, last, value, std::chars_format::general, 6).ptr - buffer.data();
+    } else {
+        used = std::to_chars(first, last, value).ptr - buffer.data();
+    }
+}
+
+// A CSV field, quoted with its quotes doubled when it has a comma, a quote or a line break
+void OutputWriter::putCsv(std::string_view field) {
+    if (field.find_first_of(",\"\r\n") == std::string_view::npos) {
+        put(field);
+        return;
+    }
+    put('"');
+    for (char c : field) {
+        if (c == '"') {
+            put('"');
+        }
+        put(c);
+    }
+    put('"');
+}
+
+// A JSON string with the quotes, backslashes and control characters escaped
+void OutputWriter::putJson(std::string_view field) {
+    static const char HEX[] = "0123456789abcdef";
+    put('"');
+    for (char c : field) {
+        if (c == '"' || c == '\\') {
+            put('\\');
+            put(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            put("\\u00");
+            put(HEX[c >> 4]);
+            put(HEX[c & 15]);
+        } else {
+            put(c);
+        }
+    }
+    put('"');
+}
+
+// A string preceded by its length in 2 bytes, little-endian
+void OutputWriter::putBinary(std::string_view field) {
+    auto length = static_cast<uint16_t>(field.size());
+    put(static_cast<char>(length & 0xff));
+    put(static_cast<char>(length >> 8));
+    put(field.substr(0, length));
+}
@@ -0,0 +1,60 @@
+#ifndef US_TRAFFIC_INCIDENTS_OUTPUTWRITER_H
+#define US_TRAFFIC_INCIDENTS_OUTPUTWRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "RowId.h"
+
+class RecordStore;
+
+// Buffered writer for rows of the store. The rows are formatted straight into a large buffer,
+// numbers with std::to_chars, and the buffer goes to the stream in one write when it fills up,
+// at flush() and when the writer is destroyed, so printing many rows costs a few writes instead of
+// one per row. The buffer is kept per thread and reused by the next writer. Formats:
+//   TEXT        ID: A-1, Severity: 2, Distance: 0.01, City: Dallas, State: TX, Zipcode: 75201
+//   CSV         the columns of the source file, with a header line
+//   JSON_LINES  one object per row: {"id":"A-1","severity":2,...}
+//   BINARY      a "USTA" header, then per row the ID, severity (1 byte), distance (8 byte double),
+//               city, state and zipcode, every string preceded by its length in 2 bytes, little-endian
+class OutputWriter {
+public:
+    enum Format { TEXT, CSV, JSON_LINES, BINARY };
+
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    explicit OutputWriter(std::ostream& out, Format format = TEXT);
+    ~OutputWriter();
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    static bool parseFormat(const std::string& name, Format& format);
+    static const char* formatName(Format format);
+
+    void header();
+    void row(const RecordStore& store, RowId row);
+    void text(std::string_view text);
+    void flush();
+    size_t getRows() const { return rows; }
+
+private:
+    std::ostream* out;
+    Format format;
+    std::vector<char> buffer;
+    size_t used = 0;
+    size_t rows = 0;
+
+    void reserve(size_t bytes);
+    void put(char c) { buffer[used++] = c; }
+    void put(std::string_view text);
+    void putInteger(long long value);
+    void putDistance(double value);
+    void putCsv(std::string_view field);
+    void putJson(std::string_view field);
+    void putBinary(std::string_view field);
+};
+
+#endif //US_TRAFFIC_INCIDENTS_OUTPUTWRITER_H
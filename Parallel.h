@@ -0,0 +1,24 @@
+#ifndef US_TRAFFIC_INCIDENTS_PARALLEL_H
+#define US_TRAFFIC_INCIDENTS_PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include "Scheduler.h"
+
+// Number of threads the parallel operators use, one per hardware thread
+inline unsigned workerCount() {
+    unsigned count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+// Run body(begin, end, worker) over [0, count) cut into morsels of morsel items, on the
+// threads of the work-stealing scheduler. body is called once per morsel, possibly many times with
+// the same worker but never twice at the same time with it, so per-worker partial results need no
+// lock as long as they accumulate. Inputs of a single morsel stay on the calling thread
+template <typename Body>
+void parallelFor(size_t count, size_t morsel, Body body) {
+    TaskScheduler::instance().run(count, morsel, TaskScheduler::Body(std::ref(body)));
+}
+
+#endif //US_TRAFFIC_INCIDENTS_PARALLEL_H
@@ -0,0 +1,14 @@
+#ifndef US_TRAFFIC_INCIDENTS_PREFETCH_H
+#define US_TRAFFIC_INCIDENTS_PREFETCH_H
+
+// Ask for the cache line holding the address ahead of its use, so independent lookups can wait on
+// memory at the same time instead of one after the other. Does nothing on compilers without the builtin
+inline void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address, 0, 3);
+#else
+    (void)address;
+#endif
+}
+
+#endif //US_TRAFFIC_INCIDENTS_PREFETCH_H
@@ -0,0 +1,643 @@
+#include "QueryEngine.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+#include "ScanKernels.h"
+#include "TopK.h"
+
+// Cost units of the planner, one unit is roughly one row visited and checked against the residual
+// predicates. A hash probe is a single random access, walking the red-black tree adds a pointer
+// chase per row, a bitmap AND touches a word per 64 rows and a SIMD column scan compares 16 rows
+// in about the time a scalar check takes for one
+constexpr double HASH_PROBE_COST = 2.0;
+constexpr double ROW_CHECK_COST = 1.0;
+constexpr double POINTER_CHASE_COST = 3.0;
+constexpr double BITMAP_ROW_COST = 1.0 / 64;
+constexpr double SCAN_ROW_COST = 1.0 / 16;
+constexpr double OUTPUT_ROW_COST = 0.25;
+
+// Read a number that must take the whole value
+static bool parseNumber(const std::string& value, double& number) {
+    try {
+        size_t used = 0;
+        number = std::stod(value, &used);
+        return used == value.size();
+    } catch (const std::invalid_argument&) {
+        return false;
+    } catch (const std::out_of_range&) {
+        return false;
+    }
+}
+
+// Parse the text form of a query and compile its filter against the store, the error says
+// which term was not understood
+bool Query::parse(const std::string& text, const RecordStore& store, Query& query, std::string& error) {
+    query = Query();
+    bool hasDistance = false;
+    double low = -std::numeric_limits<double>::infinity();
+    double high = std::numeric_limits<double>::infinity();
+    bool hasFirst = false, hasLast = false;
+
+    size_t pos = 0;
+    while (true) {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) ++pos;
+        if (pos == text.size())
+            break;
+
+        size_t start = pos;
+        while (pos < text.size() && std::isalpha(static_cast<unsigned char>(text[pos]))) ++pos;
+        std::string field = text.substr(start, pos - start);
+        std::transform(field.begin(), field.end(), field.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (field == "explain") {
+            query.explain = true;
+            continue;
+        }
+        if (field == "estimate") {
+            query.estimate = true;
+            continue;
+        }
+
+        std::string op;
+        if (text.compare(pos, 2, ">=") == 0 || text.compare(pos, 2, "<=") == 0) {
+            op = text.substr(pos, 2);
+            pos += 2;
+        } else if (pos < text.size() && text[pos] == '=') {
+            op = "=";
+            ++pos;
+        } else {
+            error = "Expected =, >= or <= after '" + (field.empty() ? text.substr(start, 1) : field) + "'";
+            return false;
+        }
+
+        //a value in double quotes may contain spaces
+        std::string value;
+        if (pos < text.size() && text[pos] == '"') {
+            size_t end = text.find('"', pos + 1);
+            if (end == std::string::npos) {
+                error = "Missing closing quote for '" + field + "'";
+                return false;
+            }
+            value = text.substr(pos + 1, end - pos - 1);
+            pos = end + 1;
+        } else {
+            start = pos;
+            while (pos < text.size() && !std::isspace(static_cast<unsigned char>(text[pos]))) ++pos;
+            value = text.substr(start, pos - start);
+        }
+        if (value.empty()) {
+            error = "Missing value for '" + field + "'";
+            return false;
+        }
+
+        if (field == "id") {
+            if (op == "=") {
+                query.id = value;
+            } else if (op == ">=") {
+                query.idFirst = value;
+                hasFirst = true;
+            } else {
+                query.idLast = value;
+                hasLast = true;
+            }
+        } else if (field == "group") {
+            if (op != "=") {
+                error = "Only = is supported for 'group'";
+                return false;
+            }
+            std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return std::tolower(c); });
+            const AccidentFilter::Field groupFields[] = {AccidentFilter::SEVERITY, AccidentFilter::CITY,
+                                                         AccidentFilter::STATE, AccidentFilter::ZIPCODE};
+            query.hasGroup = false;
+            for (auto groupField : groupFields) {
+                if (value == GroupBy::fieldName(groupField)) {
+                    query.hasGroup = true;
+                    query.groupBy = groupField;
+                }
+            }
+            if (!query.hasGroup) {
+                error = "Cannot group by '" + value + "', use severity, city, state or zipcode";
+                return false;
+            }
+        } else if (field == "top") {
+            double number;
+            if (op != "=") {
+                error = "Only = is supported for 'top'";
+                return false;
+            }
+            if (!parseNumber(value, number) || number != std::floor(number) || number < 1 || number > 1e9) {
+                error = "Top '" + value + "' is not a positive whole number";
+                return false;
+            }
+            query.top = static_cast<size_t>(number);
+        } else if (field == "distance") {
+            double number;
+            if (!parseNumber(value, number)) {
+                error = "Distance '" + value + "' is not a number";
+                return false;
+            }
+            if (op != "<=") low = std::max(low, number);
+            if (op != ">=") high = std::min(high, number);
+            hasDistance = true;
+        } else if (op != "=") {
+            error = "Only = is supported for '" + field + "'";
+            return false;
+        } else if (field == "severity") {
+            double number;
+            if (!parseNumber(value, number) || number != std::floor(number) || std::fabs(number) > 1e9) {
+                error = "Severity '" + value + "' is not a whole number";
+                return false;
+            }
+            query.filter.requireSeverity(static_cast<int>(number));
+        } else if (field == "city") {
+            query.filter.requireCity(value);
+        } else if (field == "state") {
+            query.filter.requireState(value);
+        } else if (field == "zipcode") {
+            query.filter.requireZipcode(value);
+        } else {
+            error = "Unknown field '" + field + "'";
+            return false;
+        }
+    }
+
+    //an open end of an ID range runs to the smallest or the largest possible ID
+    query.hasIdRange = hasFirst || hasLast;
+    if (query.hasIdRange && !hasLast) {
+        query.idLast = std::string(BPLUS_MAX_ID_LENGTH, '\xff');
+    }
+    if (hasDistance) {
+        query.filter.requireDistance(low, high);
+    }
+    query.filter.compile(store);
+    return true;
+}
+
+QueryEngine::QueryEngine(RecordStore& store, HashTable& hashTable, RedBlackTree& rbTree, BPlusTree& bPlusTree)
+        : store(&store), hashTable(&hashTable), rbTree(&rbTree), bPlusTree(&bPlusTree) {}
+
+// Estimate every access path that can answer the query and keep the cheapest one
+QueryPlan QueryEngine::plan(const Query& query) const {
+    QueryPlan plan;
+    double tableRows = hashTable->getSize();
+
+    //share of the rows the filter keeps, the predicates are taken as independent
+    double selectivity = query.filter.isSatisfiable() ? 1.0 : 0.0;
+    int indexed = 0, scanned = 0;
+    for (const auto& predicate : query.filter.getPredicates()) {
+        selectivity *= predicate.selectivity;
+        if (predicate.field == AccidentFilter::SEVERITY || predicate.field == AccidentFilter::STATE || predicate.field == AccidentFilter::CITY
+            || predicate.byZipKey() || AccidentFilter::usesDistanceIndex(predicate)) {
+            ++indexed;
+        } else {
+            ++scanned;
+        }
+    }
+
+    if (!query.id.empty()) {
+        plan.candidates.push_back({QueryPlan::HASH_LOOKUP, HASH_PROBE_COST + ROW_CHECK_COST, 1.0});
+    }
+    if (query.hasIdRange) {
+        //the subtree counts of the red-black tree give the exact number of IDs in the range, a tree
+        //still being built by the background load misses rows, the range is then taken as the whole table
+        bool rbTreeReady = rbTree->getSize() == hashTable->getSize();
+        double inRange = rbTreeReady ? rbTree->aggregateRange(query.idFirst, query.idLast).count : tableRows;
+        double descent = std::log2(tableRows + 2);
+        //the B+ tree is built after the rows are loaded, it can only answer once it holds every row
+        if (bPlusTree->getSize() == hashTable->getSize()) {
+            plan.candidates.push_back({QueryPlan::BPLUS_RANGE, descent + inRange * ROW_CHECK_COST, inRange});
+        }
+        if (rbTreeReady) {
+            plan.candidates.push_back({QueryPlan::RBTREE_RANGE, descent + inRange * (ROW_CHECK_COST + POINTER_CHASE_COST), inRange});
+        }
+    }
+    //like the ID range, the secondary indexes count the rows they would hand over exactly
+    for (auto path : {QueryPlan::DISTANCE_RANGE, QueryPlan::ZIPCODE_LOOKUP, QueryPlan::CITY_LOOKUP}) {
+        const AccidentFilter::Predicate* predicate = indexedPredicate(query, path);
+        if (predicate == nullptr)
+            continue;
+        double inRange, lookup;
+        if (path == QueryPlan::DISTANCE_RANGE) {
+            inRange = store->sortedDistances().countBetween(predicate->low, predicate->high);
+            lookup = std::log2(tableRows + 2);
+        } else if (path == QueryPlan::ZIPCODE_LOOKUP) {
+            inRange = store->sortedZipcodes().countBetween(predicate->keyLow, predicate->keyHigh);
+            lookup = ROW_CHECK_COST;
+        } else {
+            inRange = store->cityNames().rowCount(predicate->codes);
+            lookup = ROW_CHECK_COST * predicate->codes.size();
+        }
+        plan.candidates.push_back({path, lookup + inRange * (ROW_CHECK_COST + POINTER_CHASE_COST), inRange});
+    }
+    double scanCost = tableRows * (BITMAP_ROW_COST * (indexed + 1) + SCAN_ROW_COST * scanned)
+                      + tableRows * selectivity * (OUTPUT_ROW_COST + (query.hasIdRange ? ROW_CHECK_COST : 0));
+    plan.candidates.push_back({QueryPlan::INDEX_SCAN, scanCost, tableRows * selectivity});
+
+    const QueryPlan::Candidate* best = &plan.candidates[0];
+    for (const auto& candidate : plan.candidates) {
+        if (candidate.cost < best->cost) {
+            best = &candidate;
+        }
+    }
+    plan.path = best->path;
+    plan.cost = best->cost;
+    plan.scannedRows = best->scannedRows;
+    if (plan.path == QueryPlan::INDEX_SCAN) {
+        plan.estimatedRows = best->scannedRows;
+    } else {
+        //the rows of the path still go through the other predicates
+        const AccidentFilter::Predicate* used = indexedPredicate(query, plan.path);
+        double residual = query.filter.isSatisfiable() ? 1.0 : 0.0;
+        for (const auto& predicate : query.filter.getPredicates()) {
+            if (&predicate != used) {
+                residual *= predicate.selectivity;
+            }
+        }
+        plan.estimatedRows = best->scannedRows * residual;
+    }
+    return plan;
+}
+
+// Version of the data the queries run on, every insert and remove on a structure changes it
+uint64_t QueryEngine::version() const {
+    return hashTable->getVersion() + rbTree->getVersion() + bPlusTree->getVersion();
+}
+
+// Key of a query in the result cache: what is asked for, the ID terms and the compiled predicates
+// sorted by field, so the same query written in another order, another case or with another
+// spelling of the same city or zipcode range finds the same result
+static std::string cacheKey(const Query& query, const char* kind) {
+    std::string key = kind;
+    key += " top=" + std::to_string(query.top);
+    if (query.hasGroup) {
+        key += " group=" + std::to_string(query.groupBy);
+    }
+    if (!query.id.empty()) {
+        key += " id=" + query.id;
+    }
+    if (query.hasIdRange) {
+        key += " id>=" + query.idFirst + " id<=" + query.idLast;
+    }
+    if (!query.filter.isSatisfiable()) {
+        return key + " none";
+    }
+
+    std::vector<const AccidentFilter::Predicate*> predicates;
+    for (const auto& predicate : query.filter.getPredicates()) {
+        predicates.push_back(&predicate);
+    }
+    std::stable_sort(predicates.begin(), predicates.end(), [](const AccidentFilter::Predicate* a, const AccidentFilter::Predicate* b) {
+        return a->field < b->field;
+    });
+    char number[64];
+    for (const auto* predicate : predicates) {
+        key += " " + std::to_string(predicate->field) + "=";
+        switch (predicate->field) {
+            case AccidentFilter::SEVERITY:
+                key += std::to_string(predicate->severity);
+                break;
+            case AccidentFilter::CITY:
+                for (uint32_t code : predicate->codes) {
+                    key += std::to_string(code) + ",";
+                }
+                break;
+            case AccidentFilter::STATE:
+                key += std::to_string(predicate->code);
+                break;
+            case AccidentFilter::ZIPCODE:
+                if (predicate->byZipKey()) {
+                    key += std::to_string(predicate->keyLow) + "-" + std::to_string(predicate->keyHigh);
+                } else {
+                    key += "#" + std::to_string(predicate->code);
+                }
+                break;
+            case AccidentFilter::DISTANCE:
+                //hexadecimal floats keep every bit of the bounds
+                std::snprintf(number, sizeof(number), "%a:%a", predicate->low, predicate->high);
+                key += number;
+                break;
+        }
+    }
+    return key;
+}
+
+// Look the query up in the result cache, on a hit the plan is the one the query would run with
+// and gets the row count of the cached run
+bool QueryEngine::cached(const Query& query, const std::string& key, QueryPlan& plan, ResultCache::Result& result) const {
+    if (!cache.find(key, version(), result))
+        return false;
+    plan = this->plan(query);
+    plan.actualRows = result.actualRows;
+    plan.fromCache = true;
+    return true;
+}
+
+// Check the ID and the ID range of the query on a row found some other way
+bool QueryEngine::matchesId(const Query& query, RowId row) const {
+    if (query.id.empty() && !query.hasIdRange)
+        return true;
+    std::string_view id = store->id(row);
+    if (!query.id.empty() && id != query.id)
+        return false;
+    return !query.hasIdRange || (id >= query.idFirst && id <= query.idLast);
+}
+
+// Answer the filter of the query from the bitmap indexes and the column scans, over the rows of the table
+RowBitmap QueryEngine::scan(const Query& query) const {
+    RowBitmap selected = hashTable->getMembers();
+    query.filter.select(*store, selected);
+    if (!query.id.empty() || query.hasIdRange) {
+        for (RowId row : selected.rows()) {
+            if (!matchesId(query, row)) {
+                selected.reset(row);
+            }
+        }
+    }
+    return selected;
+}
+
+// Visit the matching rows of an ID lookup, an ID range scan or a secondary index lookup (distance,
+// zipcode or city), in the order the path finds them
+template <typename Visit>
+void QueryEngine::forEachMatch(const Query& query, QueryPlan::AccessPath path, Visit visit) const {
+    if (path == QueryPlan::HASH_LOOKUP) {
+        RowId row = hashTable->searchByID(query.id);
+        if (row != NO_ROW && matchesId(query, row) && query.filter.matches(*store, row)) {
+            visit(row);
+        }
+    } else if (path == QueryPlan::BPLUS_RANGE) {
+        for (auto cursor = bPlusTree->rangeCursor(query.idFirst, query.idLast); cursor.valid(); cursor.next()) {
+            if (matchesId(query, cursor.get()) && query.filter.matches(*store, cursor.get())) {
+                visit(cursor.get());
+            }
+        }
+    } else if (path == QueryPlan::RBTREE_RANGE) {
+        for (auto cursor = rbTree->rangeCursor(query.idFirst, query.idLast); cursor.valid(); cursor.next()) {
+            if (matchesId(query, cursor.get()->row) && query.filter.matches(*store, cursor.get()->row)) {
+                visit(cursor.get()->row);
+            }
+        }
+    } else {
+        //the store also has the rows removed from the table, the members of the hash table are the live ones
+        const AccidentFilter::Predicate* used = indexedPredicate(query, path);
+        const RowBitmap& members = hashTable->getMembers();
+        auto check = [&](RowId row) {
+            if (members.test(row) && matchesId(query, row) && query.filter.matches(*store, row)) {
+                visit(row);
+            }
+        };
+        if (path == QueryPlan::DISTANCE_RANGE) {
+            store->sortedDistances().forEachBetween(used->low, used->high, check);
+        } else if (path == QueryPlan::ZIPCODE_LOOKUP) {
+            store->sortedZipcodes().forEachBetween(used->keyLow, used->keyHigh, check);
+        } else if (path == QueryPlan::CITY_LOOKUP) {
+            for (uint32_t code : used->codes) {
+                for (RowId row : store->cityNames().rows(code)) {
+                    check(row);
+                }
+            }
+        }
+    }
+}
+
+// The predicate a secondary index path looks up: the distance range, the first numeric zipcode or
+// the first city. nullptr when the query has none or the path is not one of those
+const AccidentFilter::Predicate* QueryEngine::indexedPredicate(const Query& query, QueryPlan::AccessPath path) {
+    for (const auto& predicate : query.filter.getPredicates()) {
+        if ((path == QueryPlan::DISTANCE_RANGE && predicate.field == AccidentFilter::DISTANCE)
+            || (path == QueryPlan::ZIPCODE_LOOKUP && predicate.byZipKey())
+            || (path == QueryPlan::CITY_LOOKUP && predicate.field == AccidentFilter::CITY)) {
+            return &predicate;
+        }
+    }
+    return nullptr;
+}
+
+// Run the query along the cheapest access path, the plan gets the actual row count and the time
+std::vector<RowId> QueryEngine::execute(const Query& query, QueryPlan& plan) const {
+    auto start = std::chrono::steady_clock::now();
+    std::string key = cacheKey(query, "rows");
+    ResultCache::Result result;
+    if (!cached(query, key, plan, result)) {
+        plan = this->plan(query);
+        if (plan.path == QueryPlan::INDEX_SCAN) {
+            result.rows = scan(query).rows();
+        } else {
+            forEachMatch(query, plan.path, [&result](RowId row) { result.rows.push_back(row); });
+        }
+        plan.actualRows = result.actualRows = result.rows.size();
+        cache.store(key, version(), result);
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    plan.elapsedSeconds = elapsed.count();
+    return std::move(result.rows);
+}
+
+// Run the query without keeping the plan
+std::vector<RowId> QueryEngine::execute(const Query& query) const {
+    QueryPlan plan;
+    return execute(query, plan);
+}
+
+// Run the query into a bitmap over the store, so the operators on top of it never hold a list
+// of every matching row. The plan gets the actual row count
+RowBitmap QueryEngine::select(const Query& query, QueryPlan& plan) const {
+    plan = this->plan(query);
+    if (plan.path == QueryPlan::INDEX_SCAN) {
+        RowBitmap selected = scan(query);
+        plan.actualRows = selected.count();
+        return selected;
+    }
+    RowBitmap selected(store->size());
+    forEachMatch(query, plan.path, [&](RowId row) {
+        selected.set(row);
+        ++plan.actualRows;
+    });
+    return selected;
+}
+
+// Group the rows of the query, the plan covers selecting the rows and the time includes grouping them.
+// With top set only that many of the largest groups are kept
+std::vector<Group> QueryEngine::aggregate(const Query& query, QueryPlan& plan) const {
+    auto start = std::chrono::steady_clock::now();
+    std::string key = cacheKey(query, "groups");
+    ResultCache::Result result;
+    if (!cached(query, key, plan, result)) {
+        RowBitmap selected = select(query, plan);
+        result.groups = GroupBy::run(*store, selected, query.groupBy, query.top);
+        result.actualRows = plan.actualRows;
+        cache.store(key, version(), result);
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    plan.elapsedSeconds = elapsed.count();
+    return std::move(result.groups);
+}
+
+// The top rows of the query by distance, longest first. The rows of an ID range go straight
+// from the cursor into a heap of top rows, the bitmap of an index scan is split between threads
+// that keep a heap each
+std::vector<RowId> QueryEngine::top(const Query& query, QueryPlan& plan) const {
+    auto start = std::chrono::steady_clock::now();
+    std::string key = cacheKey(query, "top");
+    ResultCache::Result result;
+    if (!cached(query, key, plan, result)) {
+        plan = this->plan(query);
+        if (plan.path == QueryPlan::INDEX_SCAN) {
+            RowBitmap selected = scan(query);
+            plan.actualRows = selected.count();
+            result.rows = TopK::longest(*store, selected, query.top);
+        } else {
+            const RecordStore& rowStore = *store;
+            auto better = [&rowStore](RowId a, RowId b) { return TopK::longerDistance(rowStore, a, b); };
+            BoundedHeap<RowId, decltype(better)> heap(query.top, better);
+            forEachMatch(query, plan.path, [&](RowId row) {
+                heap.push(row);
+                ++plan.actualRows;
+            });
+            result.rows = heap.sorted();
+        }
+        result.actualRows = plan.actualRows;
+        cache.store(key, version(), result);
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    plan.elapsedSeconds = elapsed.count();
+    return std::move(result.rows);
+}
+
+// Rows of many IDs, NO_ROW for the missing ones, from one batched multi-get on the hash table
+std::vector<RowId> QueryEngine::lookup(const std::vector<std::string>& ids) const {
+    std::vector<RowId> rows;
+    hashTable->multiGet(ids, rows);
+    return rows;
+}
+
+// Add an accident to the store and to every structure, the error says why it was refused
+bool QueryEngine::insert(const TrafficAccident& accident, std::string& error) {
+    if (accident.severity < 0 || accident.severity > UINT8_MAX) {
+        error = "Severity " + std::to_string(accident.severity) + " is out of range";
+        return false;
+    }
+    if (!std::isfinite(accident.distance)) {
+        error = "Distance is not a finite number";
+        return false;
+    }
+    //the B+ tree keys hold the first 16 bytes of an ID, a longer one is refused by every structure
+    //so they all keep the same rows and the B+ tree stays usable for ID ranges
+    if (accident.ID.size() > BPLUS_MAX_ID_LENGTH) {
+        error = "ID " + accident.ID + " is longer than " + std::to_string(BPLUS_MAX_ID_LENGTH) + " characters";
+        return false;
+    }
+    if (hashTable->searchByID(accident.ID) != NO_ROW) {
+        error = "ID " + accident.ID + " is already in the table";
+        return false;
+    }
+    RowId row = store->append(accident);
+    if (row == NO_ROW) {
+        error = "The store refused the row";
+        return false;
+    }
+    hashTable->insertRow(row);
+    rbTree->insertRow(row);
+    bPlusTree->insertRow(row);
+    return true;
+}
+
+// Remove an ID from every structure, false when it is not in the table
+bool QueryEngine::remove(const std::string& id) {
+    if (hashTable->searchByID(id) == NO_ROW)
+        return false;
+    hashTable->remove(id);
+    rbTree->remove(id);
+    if (bPlusTree->search(id) != NO_ROW) {
+        bPlusTree->remove(id);
+    }
+    return true;
+}
+
+const char* QueryPlan::pathName(AccessPath path) {
+    switch (path) {
+        case HASH_LOOKUP: return "Hash Table ID lookup";
+        case BPLUS_RANGE: return "B+ Tree ID range scan";
+        case RBTREE_RANGE: return "Red Black Tree ID range scan";
+        case DISTANCE_RANGE: return "Distance index range scan";
+        case ZIPCODE_LOOKUP: return "Zipcode index lookup";
+        case CITY_LOOKUP: return "City index lookup";
+        case INDEX_SCAN: return "Bitmap index and column scan";
+    }
+    return "";
+}
+
+// Text of a single predicate as it is written in a query
+static std::string describe(const AccidentFilter::Predicate& predicate) {
+    switch (predicate.field) {
+        case AccidentFilter::SEVERITY: return "severity=" + std::to_string(predicate.severity);
+        case AccidentFilter::CITY: return "city=" + predicate.value;
+        case AccidentFilter::STATE: return "state=" + predicate.value;
+        case AccidentFilter::ZIPCODE: return "zipcode=" + predicate.value;
+        case AccidentFilter::DISTANCE:
+            return "distance in [" + std::to_string(predicate.low) + ", " + std::to_string(predicate.high) + "]";
+    }
+    return "";
+}
+
+// EXPLAIN output: the chosen path, what it leaves to the residual predicates (with the instruction
+// set of the column scans), the estimates against the actual rows, and the paths that were not chosen
+void QueryPlan::print(std::ostream& out, const Query& query) const {
+    out << "Plan: " << pathName(path) << std::endl;
+    if (fromCache) {
+        out << "  answered from the result cache, the plan is the one a run would use" << std::endl;
+    }
+    if (path == HASH_LOOKUP) {
+        out << "  ID = " << query.id << std::endl;
+    } else if (path == BPLUS_RANGE || path == RBTREE_RANGE) {
+        out << "  ID in [" << query.idFirst << ", " << query.idLast << "], " << scannedRows << " rows in range" << std::endl;
+    } else if (path != INDEX_SCAN) {
+        out << "  " << describe(*QueryEngine::indexedPredicate(query, path)) << ", " << scannedRows << " rows from the index" << std::endl;
+    }
+
+    std::string indexed, scanned;
+    for (const auto& predicate : query.filter.getPredicates()) {
+        if (&predicate == QueryEngine::indexedPredicate(query, path))
+            continue;
+        std::string text = describe(predicate) + " (selectivity " + std::to_string(predicate.selectivity) + ")";
+        bool usesBitmap = predicate.field == AccidentFilter::SEVERITY || predicate.field == AccidentFilter::STATE;
+        if (predicate.field == AccidentFilter::CITY) {
+            usesBitmap = true;
+            text += " from the city index";
+        } else if (predicate.byZipKey()) {
+            usesBitmap = true;
+            text += " from the zipcode index";
+        } else if (AccidentFilter::usesDistanceIndex(predicate)) {
+            usesBitmap = true;
+            text += " from the distance index";
+        }
+        std::string& list = (path == INDEX_SCAN && usesBitmap) ? indexed : scanned;
+        list += (list.empty() ? "" : ", ") + text;
+    }
+    if (path == INDEX_SCAN) {
+        if (!indexed.empty()) out << "  bitmap AND: " << indexed << std::endl;
+        if (!scanned.empty()) out << "  column scan (" << scanInstructionSet() << "): " << scanned << std::endl;
+    } else if (!scanned.empty()) {
+        out << "  residual: " << scanned << std::endl;
+    }
+    if (path != HASH_LOOKUP && !query.id.empty()) {
+        out << "  residual: ID = " << query.id << std::endl;
+    }
+    if (path != BPLUS_RANGE && path != RBTREE_RANGE && query.hasIdRange) {
+        out << "  residual: ID in [" << query.idFirst << ", " << query.idLast << "]" << std::endl;
+    }
+
+    out << "  cost " << cost << ", estimated rows " << estimatedRows << ", actual rows " << actualRows
+        << ", elapsed " << elapsedSeconds << "s" << std::endl;
+    for (const auto& candidate : candidates) {
+        if (candidate.path != path) {
+            out << "  not chosen: " << pathName(candidate.path) << " (cost " << candidate.cost << ")" << std::endl;
+        }
+    }
+}
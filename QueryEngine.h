@@ -0,0 +1,106 @@
+#ifndef US_TRAFFIC_INCIDENTS_QUERYENGINE_H
+#define US_TRAFFIC_INCIDENTS_QUERYENGINE_H
+
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include "RecordStore.h"
+#include "AccidentFilter.h"
+#include "Hash_table.h"
+#include "RedBlackTree.h"
+#include "BPlusTree.h"
+#include "GroupBy.h"
+#include "ResultCache.h"
+
+// A query of the unified query layer: an ID equality and/or an ID range (both ends included),
+// plus the attribute equalities and the distance range collected in an AccidentFilter. The text
+// form is a list of terms such as: id>=A-100 id<=A-200 severity=4 city="San Antonio"
+// distance>=2.5, with an optional leading explain (or estimate, which only plans the query). A
+// group=state term (or severity, city, zipcode) turns the query into an aggregation of the
+// matching rows, and top=20 keeps only the 20 rows with the longest distance, or the 20 largest
+// groups
+struct Query {
+    std::string id;
+    bool hasIdRange = false;
+    std::string idFirst;
+    std::string idLast;
+    AccidentFilter filter;
+    bool hasGroup = false;
+    AccidentFilter::Field groupBy = AccidentFilter::SEVERITY;
+    size_t top = 0;
+    bool explain = false;
+    bool estimate = false;
+
+    static bool parse(const std::string& text, const RecordStore& store, Query& query, std::string& error);
+};
+
+// Access path picked for a query with the estimates behind the choice, filled in by execute()
+// with the actual row count so EXPLAIN can compare them
+struct QueryPlan {
+    enum AccessPath { HASH_LOOKUP, BPLUS_RANGE, RBTREE_RANGE, DISTANCE_RANGE, ZIPCODE_LOOKUP, CITY_LOOKUP, INDEX_SCAN };
+
+    struct Candidate {
+        AccessPath path;
+        double cost;
+        double scannedRows;
+    };
+
+    AccessPath path = INDEX_SCAN;
+    double cost = 0;
+    double scannedRows = 0;    // rows the access path hands to the residual predicates
+    double estimatedRows = 0;  // rows left after all the predicates
+    std::vector<Candidate> candidates;
+    size_t actualRows = 0;
+    double elapsedSeconds = 0;
+    bool fromCache = false;
+
+    static const char* pathName(AccessPath path);
+    void print(std::ostream& out, const Query& query) const;
+};
+
+// Answers a Query from whichever structure is cheapest: the hash table for an ID, the B+ tree
+// (or the red-black tree) for an ID range, the sorted distance index for a narrow distance range,
+// the zipcode index for a zipcode, a ZIP+4 or a zipcode prefix, the city index for a city or a
+// city prefix, and the bitmap indexes plus the vectorized column scans of the store for attribute
+// conjunctions. The hash table holds the rows of the table, all the structures index the same
+// store. Results are kept in an LRU cache until an insert or a remove on one of the structures
+// changes the data. insert() and remove() change all the structures at once. The callers that
+// share the engine between threads take its lock, shared to read and exclusive to change the data
+class QueryEngine {
+public:
+    QueryEngine(RecordStore& store, HashTable& hashTable, RedBlackTree& rbTree, BPlusTree& bPlusTree);
+
+    QueryPlan plan(const Query& query) const;
+    std::vector<RowId> execute(const Query& query, QueryPlan& plan) const;
+    std::vector<RowId> execute(const Query& query) const;
+    std::vector<Group> aggregate(const Query& query, QueryPlan& plan) const;
+    std::vector<RowId> top(const Query& query, QueryPlan& plan) const;
+    std::vector<RowId> lookup(const std::vector<std::string>& ids) const;
+    bool insert(const TrafficAccident& accident, std::string& error);
+    bool remove(const std::string& id);
+
+    const RecordStore& getStore() const { return *store; }
+    const std::vector<uint32_t>& cityRows() const { return hashTable->getCityRows(); }
+    ResultCache& getCache() const { return cache; }
+    std::shared_mutex& getLock() const { return lock; }
+    uint64_t version() const;
+    static const AccidentFilter::Predicate* indexedPredicate(const Query& query, QueryPlan::AccessPath path);
+
+private:
+    RecordStore* store;
+    HashTable* hashTable;
+    RedBlackTree* rbTree;
+    BPlusTree* bPlusTree;
+    mutable ResultCache cache;
+    mutable std::shared_mutex lock;
+
+    bool matchesId(const Query& query, RowId row) const;
+    template <typename Visit>
+    void forEachMatch(const Query& query, QueryPlan::AccessPath path, Visit visit) const;
+    RowBitmap scan(const Query& query) const;
+    RowBitmap select(const Query& query, QueryPlan& plan) const;
+    bool cached(const Query& query, const std::string& key, QueryPlan& plan, ResultCache::Result& result) const;
+};
+
+#endif //US_TRAFFIC_INCIDENTS_QUERYENGINE_H
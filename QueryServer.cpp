@@ -0,0 +1,441 @@
+#include "QueryServer.h"
+#include <iostream>
+
+QueryServer::QueryServer(QueryEngine& engine, const BackgroundLoader& loader, std::string path, unsigned workers)
+        : engine(&engine), loader(&loader), path(std::move(path)), workers(workers == 0 ? 1 : workers) {}
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "BatchRunner.h"
+
+// epoll tags of the listening socket, the wakeup eventfd and the signalfd, connections are tagged
+// with their serial number from FIRST_CONNECTION on, so a reused descriptor is never mistaken for
+// the connection it replaced
+constexpr uint64_t LISTEN_TAG = 0;
+constexpr uint64_t WAKEUP_TAG = 1;
+constexpr uint64_t SIGNAL_TAG = 2;
+constexpr uint64_t FIRST_CONNECTION = 3;
+
+// Answers waiting to be written past this size stop the reading of new commands of a connection,
+// as do commands waiting to be run past INPUT_LIMIT, so a client that sends without reading can
+// grow neither without bound. A line longer than INPUT_LIMIT drops the connection
+constexpr size_t OUTPUT_LIMIT = 4 * 1024 * 1024;
+constexpr size_t INPUT_LIMIT = 4 * 1024 * 1024;
+
+bool QueryServer::isSupported() {
+    return true;
+}
+
+namespace {
+
+// Complete lines of a connection handed to a worker, and the answers it hands back
+struct Task {
+    uint64_t connection;
+    std::string lines;
+    std::string output;
+    size_t requests = 0;
+};
+
+struct Connection {
+    int fd;
+    std::string input;
+    std::string output;
+    size_t sent = 0;      // bytes of output already written
+    bool busy = false;    // a worker has its lines, the next ones wait so the answers stay in order
+    bool reading = true;  // EPOLLIN is on, off once the client hung up or while over the limits
+    bool writing = false; // EPOLLOUT is on, the socket was full
+    bool hungUp = false;
+    bool broken = false;
+
+    explicit Connection(int fd = -1) : fd(fd) {}
+};
+
+// Queue of tasks for the workers, and of finished tasks for the loop, which the eventfd wakes up
+class WorkQueue {
+public:
+    explicit WorkQueue(int wakeup) : wakeup(wakeup) {}
+
+    void push(Task task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(std::move(task));
+        }
+        ready.notify_one();
+    }
+
+    bool pop(Task& task) {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty())
+            return false;
+        task = std::move(pending.front());
+        pending.pop_front();
+        return true;
+    }
+
+    void finish(Task task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(std::move(task));
+        }
+        uint64_t one = 1;
+        if (write(wakeup, &one, sizeof(one)) < 0) {
+            //the counter cannot overflow with one write per task, nothing to do
+        }
+    }
+
+    std::deque<Task> takeFinished() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::deque<Task> done;
+        done.swap(finished);
+        return done;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        ready.notify_all();
+    }
+
+private:
+    int wakeup;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Task> pending;
+    std::deque<Task> finished;
+    bool stopping = false;
+};
+
+}
+
+// Run the commands of the task one line at a time, readers share the structures and a writer has
+// them alone. A run of get commands pipelined by the client is answered by one batched lookup.
+// Once the answers pass OUTPUT_LIMIT the lines left are handed back with them, to be run after the
+// answers are written
+static void work(WorkQueue& queue, const BatchRunner& runner, std::shared_mutex& dataLock) {
+    Task task;
+    std::vector<std::string> gets;
+    while (queue.pop(task)) {
+        std::ostringstream out;
+        auto answerGets = [&]() {
+            if (gets.empty())
+                return;
+            std::shared_lock<std::shared_mutex> lock(dataLock);
+            runner.getMany(gets, out);
+            gets.clear();
+        };
+        size_t start = 0;
+        while (start < task.lines.size()) {
+            size_t end = task.lines.find('\n', start);
+            std::string line = task.lines.substr(start, end - start);
+            start = end + 1;
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (BatchRunner::isSkipped(line))
+                continue;
+            ++task.requests;
+            std::string id;
+            if (BatchRunner::parseGet(line, id)) {
+                gets.push_back(id);
+                continue;
+            }
+            answerGets();
+            if (BatchRunner::modifies(line)) {
+                runner.waitForLoad();
+                std::unique_lock<std::shared_mutex> lock(dataLock);
+                runner.execute(line, out);
+            } else {
+                std::shared_lock<std::shared_mutex> lock(dataLock);
+                runner.execute(line, out);
+            }
+            if (static_cast<size_t>(out.tellp()) > OUTPUT_LIMIT)
+                break;
+        }
+        answerGets();
+        task.output = out.str();
+        task.lines.erase(0, std::min(start, task.lines.size()));
+        queue.finish(std::move(task));
+    }
+}
+
+// Add or change the events epoll watches for a descriptor
+static void watch(int epoll, int operation, int fd, uint32_t events, uint64_t tag) {
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = tag;
+    epoll_ctl(epoll, operation, fd, &event);
+}
+
+// Watch a connection for commands while it is reading, and for room to write while answers wait
+static void rewatch(int epoll, uint64_t tag, const Connection& connection) {
+    uint32_t events = (connection.reading ? static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP) : 0U)
+                      | (connection.writing ? static_cast<uint32_t>(EPOLLOUT) : 0U);
+    watch(epoll, EPOLL_CTL_MOD, connection.fd, events, tag);
+}
+
+// Read the commands of a connection until the client hangs up, pausing while its answers or its
+// waiting commands are over their limits
+static void throttle(int epoll, uint64_t tag, Connection& connection) {
+    bool reading = !connection.hungUp && connection.output.size() <= OUTPUT_LIMIT && connection.input.size() <= INPUT_LIMIT;
+    if (reading != connection.reading && !connection.broken) {
+        connection.reading = reading;
+        rewatch(epoll, tag, connection);
+    }
+}
+
+// Write as much of the answers as the socket takes, watching for room when it is full
+static void flush(int epoll, uint64_t tag, Connection& connection) {
+    while (!connection.broken && connection.sent < connection.output.size()) {
+        ssize_t written = send(connection.fd, connection.output.data() + connection.sent,
+                               connection.output.size() - connection.sent, MSG_NOSIGNAL);
+        if (written > 0) {
+            connection.sent += static_cast<size_t>(written);
+        } else if (written < 0 && errno == EINTR) {
+            continue;
+        } else if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!connection.writing) {
+                connection.writing = true;
+                rewatch(epoll, tag, connection);
+            }
+            return;
+        } else {
+            //the client is gone, its answers are dropped
+            connection.broken = true;
+            break;
+        }
+    }
+    connection.output.clear();
+    connection.sent = 0;
+    if (connection.writing && !connection.broken) {
+        connection.writing = false;
+        rewatch(epoll, tag, connection);
+    }
+}
+
+// Hand the complete lines of an idle connection to the workers
+static void dispatch(WorkQueue& queue, uint64_t tag, Connection& connection) {
+    if (connection.busy || connection.broken || connection.output.size() > OUTPUT_LIMIT)
+        return;
+    if (connection.hungUp && !connection.input.empty() && connection.input.back() != '\n') {
+        connection.input += '\n';
+    }
+    size_t last = connection.input.rfind('\n');
+    if (last == std::string::npos) {
+        if (connection.input.size() > INPUT_LIMIT) {
+            connection.broken = true;
+        }
+        return;
+    }
+    Task task;
+    task.connection = tag;
+    task.lines = connection.input.substr(0, last + 1);
+    connection.input.erase(0, last + 1);
+    connection.busy = true;
+    queue.push(std::move(task));
+}
+
+// Read what the client sent up to INPUT_LIMIT, noting when it hung up
+static void receive(Connection& connection) {
+    char buffer[64 * 1024];
+    while (connection.input.size() <= INPUT_LIMIT) {
+        ssize_t received = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            connection.input.append(buffer, static_cast<size_t>(received));
+        } else if (received < 0 && errno == EINTR) {
+            continue;
+        } else if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        } else {
+            connection.hungUp = true;
+            return;
+        }
+    }
+}
+
+// Create the listening socket, replacing a socket file left by a server that is no longer running
+static int listenOn(const std::string& path) {
+    sockaddr_un address{};
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        std::cout << "Error: The socket path must have between 1 and " << sizeof(address.sun_path) - 1 << " characters" << std::endl;
+        return -1;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0 && connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+        close(probe);
+        std::cout << "Error: A server is already listening on " << path << std::endl;
+        return -1;
+    }
+    if (probe >= 0) {
+        close(probe);
+    }
+    unlink(path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        std::cout << "Error: Could not listen on " << path << ": " << std::strerror(errno) << std::endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+// Serve until SIGINT or SIGTERM, false when the server could not start
+bool QueryServer::run() {
+    int listener = listenOn(path);
+    if (listener < 0)
+        return false;
+
+    //the signals are read from a descriptor by the loop, the workers inherit the mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    int signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    int wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    watch(epoll, EPOLL_CTL_ADD, listener, EPOLLIN, LISTEN_TAG);
+    watch(epoll, EPOLL_CTL_ADD, wakeup, EPOLLIN, WAKEUP_TAG);
+    watch(epoll, EPOLL_CTL_ADD, signalFd, EPOLLIN, SIGNAL_TAG);
+
+    BatchRunner runner(*engine, loader);
+    std::shared_mutex& dataLock = engine->getLock();
+    WorkQueue queue(wakeup);
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < workers; ++i) {
+        pool.emplace_back(work, std::ref(queue), std::cref(runner), std::ref(dataLock));
+    }
+    std::cout << "Serving on " << path << " with " << workers << " workers, Ctrl+C to stop." << std::endl;
+
+    std::unordered_map<uint64_t, Connection> open;
+    uint64_t nextTag = FIRST_CONNECTION;
+    auto closeIfDone = [&](uint64_t tag, Connection& connection) {
+        if (connection.busy || !(connection.broken || (connection.hungUp && connection.output.empty())))
+            return;
+        epoll_ctl(epoll, EPOLL_CTL_DEL, connection.fd, nullptr);
+        close(connection.fd);
+        open.erase(tag);
+    };
+
+    bool running = true;
+    epoll_event events[64];
+    while (running) {
+        int count = epoll_wait(epoll, events, 64, -1);
+        if (count < 0 && errno != EINTR)
+            break;
+        for (int i = 0; i < count; ++i) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == SIGNAL_TAG) {
+                //take the signal, or it would be delivered when the mask is restored
+                signalfd_siginfo received;
+                if (read(signalFd, &received, sizeof(received)) == sizeof(received)) {
+                    running = false;
+                }
+            } else if (tag == LISTEN_TAG) {
+                int fd;
+                while ((fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    open[nextTag] = Connection(fd);
+                    watch(epoll, EPOLL_CTL_ADD, fd, EPOLLIN | EPOLLRDHUP, nextTag);
+                    ++nextTag;
+                    ++connections;
+                }
+            } else if (tag == WAKEUP_TAG) {
+                uint64_t ignored;
+                if (read(wakeup, &ignored, sizeof(ignored)) < 0) {
+                    //already drained by an earlier wakeup, the finished list is read anyway
+                }
+                for (Task& task : queue.takeFinished()) {
+                    requests += task.requests;
+                    auto found = open.find(task.connection);
+                    if (found == open.end())
+                        continue;
+                    Connection& connection = found->second;
+                    connection.busy = false;
+                    connection.output += task.output;
+                    connection.input.insert(0, task.lines);
+                    flush(epoll, task.connection, connection);
+                    dispatch(queue, task.connection, connection);
+                    throttle(epoll, task.connection, connection);
+                    closeIfDone(task.connection, connection);
+                }
+            } else {
+                auto found = open.find(tag);
+                if (found == open.end())
+                    continue;
+                Connection& connection = found->second;
+                if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                    //closed both ways, nothing can be answered; epoll would report it again and again
+                    connection.broken = true;
+                    epoll_ctl(epoll, EPOLL_CTL_DEL, connection.fd, nullptr);
+                } else {
+                    if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+                        receive(connection);
+                    }
+                    if (events[i].events & EPOLLOUT) {
+                        flush(epoll, tag, connection);
+                    }
+                }
+                dispatch(queue, tag, connection);
+                throttle(epoll, tag, connection);
+                closeIfDone(tag, connection);
+            }
+        }
+    }
+
+    queue.stop();
+    for (auto& worker : pool) {
+        worker.join();
+    }
+    for (auto& entry : open) {
+        close(entry.second.fd);
+    }
+    close(epoll);
+    close(wakeup);
+    close(signalFd);
+    close(listener);
+    unlink(path.c_str());
+    pthread_sigmask(SIG_UNBLOCK, &signals, nullptr);
+    std::cout << "Served " << requests << " requests on " << connections << " connections." << std::endl;
+    return true;
+}
+
+#else
+
+bool QueryServer::isSupported() {
+    return false;
+}
+
+bool QueryServer::run() {
+    std::cout << "Error: The query server needs Linux (epoll)" << std::endl;
+    return false;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef US_TRAFFIC_INCIDENTS_QUERYSERVER_H
+#define US_TRAFFIC_INCIDENTS_QUERYSERVER_H
+
+#include <cstddef>
+#include <string>
+#include "QueryEngine.h"
+#include "BackgroundLoader.h"
+
+// Serves the batch commands to many clients over a Unix domain socket, so the data is loaded once.
+// The protocol is the batch one: a client writes one command per line and reads the rows of each
+// answer up to its OK or ERROR line. One thread runs an epoll loop that accepts the connections and
+// reads and writes the sockets, the complete lines of a connection go to a pool of workers, and
+// the answers come back to the loop to be written. A client may pipeline, writing many lines
+// without waiting, the answers come back in order and a run of get commands takes one batched
+// lookup. The workers share the structures, reads run together and an insert or a remove waits
+// for them and runs alone. The server takes clients while the data is still loading in the
+// background, the queries see the rows loaded so far and the inserts and removes wait. Linux only
+class QueryServer {
+public:
+    QueryServer(QueryEngine& engine, const BackgroundLoader& loader, std::string path, unsigned workers);
+
+    static bool isSupported();
+    bool run();
+
+    size_t getRequests() const { return requests; }
+    size_t getConnections() const { return connections; }
+
+private:
+    QueryEngine* engine;
+    const BackgroundLoader* loader;
+    std::string path;
+    unsigned workers;
+    size_t requests = 0;
+    size_t connections = 0;
+};
+
+#endif //US_TRAFFIC_INCIDENTS_QUERYSERVER_H
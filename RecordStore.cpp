@@ -0,0 +1,90 @@
+#include "RecordStore.h"
+#include <cmath>
+#include <iostream>
+
+// Return the code of the string, giving it the next free code the first time it is seen
+uint32_t StringDictionary::intern(const std::string& value) {
+    auto it = codes.find(value);
+    if (it != codes.end())
+        return it->second;
+    auto code = static_cast<uint32_t>(values.size());
+    values.push_back(value);
+    codes.emplace(value, code);
+    return code;
+}
+
+// Return the code of the string, NOT_FOUND if no row ever used it
+uint32_t StringDictionary::lookup(const std::string& value) const {
+    auto it = codes.find(value);
+    return it == codes.end() ? NOT_FOUND : it->second;
+}
+
+// Get the string behind a code
+const std::string& StringDictionary::value(uint32_t code) const {
+    return values[code];
+}
+
+// Number of distinct strings
+size_t StringDictionary::size() const {
+    return values.size();
+}
+
+// Append a row to every column and return its row number, NO_ROW if a value does not fit its column
+// or the distance is not a finite number
+RowId RecordStore::append(const std::string& id, int severity, double distance, const std::string& city, const std::string& state, const std::string& zipcode) {
+    if (severity < 0 || severity > UINT8_MAX) {
+        std::cout << "Severity " << severity << " is out of range, no element inserted." << std::endl;
+        return NO_ROW;
+    }
+    //a NaN has no place in the order of the distance index, an infinity none in its histogram
+    if (!std::isfinite(distance)) {
+        std::cout << "Distance " << distance << " is not a finite number, no element inserted." << std::endl;
+        return NO_ROW;
+    }
+    uint32_t stateCode = stateDictionary.intern(state);
+    if (stateCode > UINT16_MAX) {
+        std::cout << "Too many distinct states, no element inserted." << std::endl;
+        return NO_ROW;
+    }
+
+    auto row = static_cast<RowId>(severities.size());
+    idChars.insert(idChars.end(), id.begin(), id.end());
+    idOffsets.push_back(static_cast<uint32_t>(idChars.size()));
+    severities.push_back(static_cast<uint8_t>(severity));
+    distances.push_back(distance);
+    size_t cityCount = cityDictionary.size();
+    uint32_t cityCode = cityDictionary.intern(city);
+    if (cityDictionary.size() > cityCount) {
+        cityIndex.addCity(cityCode, city);
+    }
+    cityCodes.push_back(cityCode);
+    stateCodes.push_back(static_cast<uint16_t>(stateCode));
+    uint32_t zipCode = zipDictionary.intern(zipcode);
+    if (zipCode == zipKeys.size()) {
+        zipKeys.push_back(ZipIndex::key(zipcode));
+    }
+    zipCodes.push_back(zipCode);
+    severityIndex.add(static_cast<uint32_t>(severity), row);
+    stateIndex.add(stateCode, row);
+    distanceIndex.add(distance, row);
+    cityIndex.addRow(cityCode, row);
+    if (zipKeys[zipCode] != ZipIndex::NO_KEY) {
+        zipIndex.add(zipKeys[zipCode], row);
+    }
+    if (row % ZoneMap::ROWS == 0) {
+        zoneMaps.emplace_back();
+    }
+    zoneMaps.back().add(static_cast<uint8_t>(severity), distance, static_cast<uint16_t>(stateCode), cityCode, zipCode, zipKeys[zipCode]);
+    return row;
+}
+
+// Append a row built from a TrafficAccident
+RowId RecordStore::append(const TrafficAccident& accident) {
+    return append(accident.ID, accident.severity, accident.distance, accident.city, accident.state, accident.zipcode);
+}
+
+// Number of rows ever appended
+size_t RecordStore::size() const {
+    return severities.size();
+}
+
@@ -0,0 +1,97 @@
+#ifndef US_TRAFFIC_INCIDENTS_RECORDSTORE_H
+#define US_TRAFFIC_INCIDENTS_RECORDSTORE_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "TrafficAccident.h"
+#include "RowId.h"
+#include "RoaringBitmap.h"
+#include "DistanceIndex.h"
+#include "ZipIndex.h"
+#include "CityIndex.h"
+#include "ZoneMap.h"
+#include "Prefetch.h"
+
+// Maps each distinct string to a dense code, so a column can hold small integers instead of strings
+class StringDictionary {
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    uint32_t intern(const std::string& value);
+    uint32_t lookup(const std::string& value) const;
+    const std::string& value(uint32_t code) const;
+    size_t size() const;
+
+private:
+    std::vector<std::string> values;
+    std::unordered_map<std::string, uint32_t> codes;
+};
+
+// Central columnar (structure of arrays) store for the accidents. Each attribute lives in its
+// own contiguous array indexed by row number, and city, state and zipcode are dictionary codes.
+// HashTable, RedBlackTree and BPlusTree index row numbers of a shared store instead of owning
+// copies of the records. Rows are only ever appended; removing an ID from an index drops it
+// from that index, the row itself stays in the store. Severity and state, which have few distinct
+// values, also get a bitmap index that append keeps up to date, distance gets a sorted index, the
+// zipcodes an index on their numeric form and the city names a trie with a posting list per city.
+// Every block of ZoneMap::ROWS rows also gets a zone map that append keeps up to date
+class RecordStore {
+public:
+    RowId append(const std::string& id, int severity, double distance, const std::string& city, const std::string& state, const std::string& zipcode);
+    RowId append(const TrafficAccident& accident);
+    size_t size() const;
+
+    std::string_view id(RowId row) const { return std::string_view(idChars.data() + idOffsets[row], idOffsets[row + 1] - idOffsets[row]); }
+    void prefetchId(RowId row) const { prefetch(idChars.data() + idOffsets[row]); }
+    int severity(RowId row) const { return severities[row]; }
+    double distance(RowId row) const { return distances[row]; }
+    uint32_t cityCode(RowId row) const { return cityCodes[row]; }
+    uint16_t stateCode(RowId row) const { return stateCodes[row]; }
+    uint32_t zipCode(RowId row) const { return zipCodes[row]; }
+    const std::string& city(RowId row) const { return cityDictionary.value(cityCodes[row]); }
+    const std::string& state(RowId row) const { return stateDictionary.value(stateCodes[row]); }
+    const std::string& zipcode(RowId row) const { return zipDictionary.value(zipCodes[row]); }
+    uint32_t zipKey(RowId row) const { return zipKeys[zipCodes[row]]; }
+
+    // Raw columns for the scan kernels
+    const uint8_t* severityColumn() const { return severities.data(); }
+    const uint16_t* stateColumn() const { return stateCodes.data(); }
+    const uint32_t* cityColumn() const { return cityCodes.data(); }
+    const uint32_t* zipColumn() const { return zipCodes.data(); }
+    const double* distanceColumn() const { return distances.data(); }
+
+    const StringDictionary& cities() const { return cityDictionary; }
+    const StringDictionary& states() const { return stateDictionary; }
+    const StringDictionary& zipcodes() const { return zipDictionary; }
+    const BitmapIndex& severityBitmaps() const { return severityIndex; }
+    const BitmapIndex& stateBitmaps() const { return stateIndex; }
+    const DistanceIndex& sortedDistances() const { return distanceIndex; }
+    const ZipIndex& sortedZipcodes() const { return zipIndex; }
+    const CityIndex& cityNames() const { return cityIndex; }
+    const std::vector<ZoneMap>& zones() const { return zoneMaps; }
+
+private:
+    std::vector<char> idChars;
+    std::vector<uint32_t> idOffsets{0};
+    std::vector<uint8_t> severities;
+    std::vector<double> distances;
+    std::vector<uint32_t> cityCodes;
+    std::vector<uint16_t> stateCodes;
+    std::vector<uint32_t> zipCodes;
+    StringDictionary cityDictionary;
+    StringDictionary stateDictionary;
+    StringDictionary zipDictionary;
+    std::vector<uint32_t> zipKeys; // ZipIndex key of each zipcode code
+    BitmapIndex severityIndex;
+    BitmapIndex stateIndex;
+    DistanceIndex distanceIndex;
+    ZipIndex zipIndex;
+    CityIndex cityIndex;
+    std::vector<ZoneMap> zoneMaps;
+};
+
+#endif //US_TRAFFIC_INCIDENTS_RECORDSTORE_H
@@ -1,12 +1,23 @@
 #include "RedBlackTree.h"
+#include <algorithm>
 #include <vector>
-#include <functional>
-
-// Constructor initializes the root to nullptr
-RedBlackTree::RedBlackTree() : root(nullptr) {}
+#include "Parallel.h"
+
+// Constructor initializes the root to nullptr, the tree indexes rows of the given store
+RedBlackTree::RedBlackTree(RecordStore& store) : store(&store), root(nullptr) {}
+
+// Recompute the subtree totals of a node from its own record and its children
+void RedBlackTree::updateAggregate(Node* node) const {
+    Aggregate totals;
+    totals.addRecord(store->severity(node->row), store->distance(node->row));
+    if (node->left != nullptr) totals.add(node->left->subtree);
+    if (node->right != nullptr) totals.add(node->right->subtree);
+    node->subtree = totals;
+}
 
 // Rotate the subtree left around the given node
 void RedBlackTree::rotateLeft(Node*& node) {
+    Node* pivot = node;
     Node* rightChild = node->right;
     node->right = rightChild->left;
     if (node->right != nullptr) {
@@ -22,10 +33,15 @@ void RedBlackTree::rotateLeft(Node*& node) {
     }
     rightChild->left = node;
     node->parent = rightChild;
+
+    //only the two nodes that swapped places cover a different set of records now
+    updateAggregate(pivot);
+    updateAggregate(rightChild);
 }
 
 // Rotate the subtree right around the given node
 void RedBlackTree::rotateRight(Node*& node) {
+    Node* pivot = node;
     Node* leftChild = node->left;
     node->left = leftChild->right;
     if (node->left != nullptr) {
@@ -41,6 +57,9 @@ void RedBlackTree::rotateRight(Node*& node) {
     }
     leftChild->right = node;
     node->parent = leftChild;
+
+    updateAggregate(pivot);
+    updateAggregate(leftChild);
 }
 
 // Fix the red-black tree properties after insertion
@@ -103,65 +122,87 @@ void RedBlackTree::transplant(Node* u, Node* v) {
     }
 }
 
-// Fix the red-black tree properties after deletion
-void RedBlackTree::fixDelete(Node*& node) {
-    while (node != root && node->color == BLACK) {
-        if (node == node->parent->left) {
-            Node* sibling = node->parent->right;
+// Missing children count as black leaves
+static bool isBlack(const Node* node) {
+    return node == nullptr || node->color == BLACK;
+}
+
+// Fix the red-black tree properties after deletion, the node taking the removed node's place
+// may be a null leaf so its parent is passed along with it
+void RedBlackTree::fixDelete(Node* node, Node* parent) {
+    while (node != root && isBlack(node)) {
+        if (node == parent->left) {
+            Node* sibling = parent->right;
             if (sibling->color == RED) {
                 sibling->color = BLACK;
-                node->parent->color = RED;
-                rotateLeft(node->parent);
-                sibling = node->parent->right;
+                parent->color = RED;
+                rotateLeft(parent);
+                sibling = parent->right;
             }
-            if (sibling->left->color == BLACK && sibling->right->color == BLACK) {
+            if (isBlack(sibling->left) && isBlack(sibling->right)) {
                 sibling->color = RED;
-                node = node->parent;
+                node = parent;
+                parent = node->parent;
             } else {
-                if (sibling->right->color == BLACK) {
+                if (isBlack(sibling->right)) {
                     sibling->left->color = BLACK;
                     sibling->color = RED;
                     rotateRight(sibling);
-                    sibling = node->parent->right;
+                    sibling = parent->right;
                 }
-                sibling->color = node->parent->color;
-                node->parent->color = BLACK;
+                sibling->color = parent->color;
+                parent->color = BLACK;
                 sibling->right->color = BLACK;
-                rotateLeft(node->parent);
+                rotateLeft(parent);
                 node = root;
             }
         } else {
-            Node* sibling = node->parent->left;
+            Node* sibling = parent->left;
             if (sibling->color == RED) {
                 sibling->color = BLACK;
-                node->parent->color = RED;
-                rotateRight(node->parent);
-                sibling = node->parent->left;
+                parent->color = RED;
+                rotateRight(parent);
+                sibling = parent->left;
             }
-            if (sibling->right->color == BLACK && sibling->left->color == BLACK) {
+            if (isBlack(sibling->right) && isBlack(sibling->left)) {
                 sibling->color = RED;
-                node = node->parent;
+                node = parent;
+                parent = node->parent;
             } else {
-                if (sibling->left->color == BLACK) {
+                if (isBlack(sibling->left)) {
                     sibling->right->color = BLACK;
                     sibling->color = RED;
                     rotateLeft(sibling);
-                    sibling = node->parent->left;
+                    sibling = parent->left;
                 }
-                sibling->color = node->parent->color;
-                node->parent->color = BLACK;
+                sibling->color = parent->color;
+                parent->color = BLACK;
                 sibling->left->color = BLACK;
-                rotateRight(node->parent);
+                rotateRight(parent);
                 node = root;
             }
         }
     }
-    node->color = BLACK;
+    if (node != nullptr) {
+        node->color = BLACK;
+    }
 }
 
-// Insert a new node with the given data into the red-black tree
+// Insert a new node with the given data into the red-black tree, the data goes to the store
 void RedBlackTree::insert(const std::string& id, int severity, double distance, const std::string& city, const std::string& state, const std::string& zipcode) {
-    Node* newNode = new Node(id, severity, distance, city, state, zipcode);
+    RowId row = store->append(id, severity, distance, city, state, zipcode);
+    if (row != NO_ROW) {
+        insertRow(row);
+    }
+}
+
+// Insert a node for a row that is already in the store
+void RedBlackTree::insertRow(RowId row) {
+    ++version;
+    int severity = store->severity(row);
+    double distance = store->distance(row);
+    std::string_view id = store->id(row);
+    Node* newNode = new Node(row, severity, distance);
     if (root == nullptr) {
         newNode->color = BLACK;
         root = newNode;
@@ -170,20 +211,53 @@ void RedBlackTree::insert(const std::string& id, int severity, double distance,
         Node* current = root;
         while (current != nullptr) {
             parent = current;
-            if (newNode->ID < current->ID) {
+            if (id < key(current)) {
                 current = current->left;
             } else {
                 current = current->right;
             }
         }
         newNode->parent = parent;
-        if (newNode->ID < parent->ID) {
+        if (id < key(parent)) {
             parent->left = newNode;
         } else {
             parent->right = newNode;
         }
+        //every ancestor gains the new record, rotations in fixInsert then recompute the nodes they move
+        for (Node* ancestor = parent; ancestor != nullptr; ancestor = ancestor->parent) {
+            ancestor->subtree.addRecord(severity, distance);
+        }
         fixInsert(newNode);
     }
+    idFilter.add(IdFilter::hash(id));
+    if (idFilter.needsRebuild()) {
+        rebuildFilter(2 * static_cast<size_t>(getSize()));
+    }
+}
+
+// Size the ID filter for the given number of IDs ahead of a bulk load, so it is not rebuilt each
+// time the tree doubles
+void RedBlackTree::reserve(size_t ids) {
+    if (ids > idFilter.getCapacity()) {
+        rebuildFilter(ids);
+    }
+}
+
+// Refill the ID filter, sized for the given number of IDs, from the IDs in the tree. Done after
+// many removes or once the tree outgrew it
+void RedBlackTree::rebuildFilter(size_t ids) {
+    idFilter.reset(ids);
+    for (const Node& node : *this) {
+        idFilter.add(IdFilter::hash(key(&node)));
+    }
+}
+
+// Find the node with the maximum value in the subtree rooted at the given node
+Node* RedBlackTree::maximum(Node* node) {
+    while (node->right != nullptr) {
+        node = node->right;
+    }
+    return node;
 }
 
 // Find the node with the minimum value in the subtree rooted at the given node
@@ -194,56 +268,142 @@ Node* RedBlackTree::minimum(Node* node) {
     return node;
 }
 
-// Search for a node with the given ID in the red-black tree
-Node* RedBlackTree::search(const std::string& id) {
-    return searchTreeHelper(root, id);
+// Search for a node with the given ID in the red-black tree, an ID the filter rules out is not
+// looked for
+Node* RedBlackTree::search(const std::string& id) const {
+    if (!idFilter.mayContain(IdFilter::hash(id)))
+        return nullptr;
+    Node* node = root;
+    while (node != nullptr && key(node) != id) {
+        node = (id < key(node)) ? node->left : node->right;
+    }
+    return node;
 }
 
-// Helper function to search for a node with the given ID in the subtree rooted at the given node
-Node* RedBlackTree::searchTreeHelper(Node* node, const std::string& id) {
-    if (node == nullptr || node->ID == id)
-        return node;
-    if (id < node->ID)
-        return searchTreeHelper(node->left, id);
-    return searchTreeHelper(node->right, id);
-}
+// Look up many IDs at once, nodes[i] is the node of ids[i] or nullptr. A lookup alone waits on a
+// cache miss for every node and ID on its way down, so several descents are interleaved: each
+// round every lane prefetches the ID of its current node (read from the node fetched the round
+// before), then compares and moves to a child that it prefetches for the next round. A lane that
+// finishes takes the next ID the filter lets through, and the misses of all the lanes overlap
+void RedBlackTree::multiGet(const std::vector<std::string>& ids, std::vector<Node*>& nodes) const {
+    constexpr size_t LANES = 16;
+    size_t lookup[LANES];
+    Node* current[LANES];
+    size_t active = 0, next = 0;
+    nodes.assign(ids.size(), nullptr);
+
+    //a lane is live while it has an ID and a node to compare it with
+    auto start = [&](size_t lane) {
+        while (next < ids.size()) {
+            lookup[lane] = next++;
+            if (root != nullptr && idFilter.mayContain(IdFilter::hash(ids[lookup[lane]]))) {
+                current[lane] = root;
+                return true;
+            }
+        }
+        return false;
+    };
+    while (active < LANES && start(active)) {
+        ++active;
+    }
 
-// Helper function to perform inorder traversal of the red-black tree and print node data
-void RedBlackTree::inorderHelper(Node* node) {
-    if (node == nullptr)
-        return;
-    inorderHelper(node->left);
-    std::cout << "ID: " << node->ID << ", Severity: " << node->severity << ", Distance: " << node->distance
-              << ", City: " << node->city << ", State: " << node->state << ", Zipcode: " << node->zipcode << std::endl;
-    inorderHelper(node->right);
+    while (active > 0) {
+        for (size_t lane = 0; lane < active; ++lane) {
+            store->prefetchId(current[lane]->row);
+        }
+        for (size_t lane = 0; lane < active;) {
+            Node* node = current[lane];
+            const std::string& id = ids[lookup[lane]];
+            int order = id.compare(key(node));
+            Node* child = order < 0 ? node->left : node->right;
+            if (order == 0 || child == nullptr) {
+                if (order == 0) {
+                    nodes[lookup[lane]] = node;
+                }
+                //refill the lane, or move the last live lane into it
+                if (!start(lane)) {
+                    --active;
+                    lookup[lane] = lookup[active];
+                    current[lane] = current[active];
+                    continue;
+                }
+            } else {
+                current[lane] = child;
+            }
+            prefetch(current[lane]);
+            ++lane;
+        }
+    }
 }
 
 // Perform inorder traversal of the red-black tree and print node data
-void RedBlackTree::inorder() {
-    inorderHelper(root);
+void RedBlackTree::inorder(OutputWriter& out) {
+    for (const Node& node : *this) {
+        out.row(*store, node.row);
+    }
 }
 
-// Find nodes that match the given criteria
-std::vector<Node*> RedBlackTree::find(int severity, const std::string& city, const std::string& state, const std::string& zipcode) {
-    std::vector<Node*> result;
-    findHelper(root, severity, city, state, zipcode, result);
-    return result;
+// Find nodes that match the given criteria, a severity of 0 or an empty string matches anything
+std::vector<Node*> RedBlackTree::find(int severity, const std::string& city, const std::string& state, const std::string& zipcode) const {
+    AccidentFilter filter;
+    if (severity != 0) filter.requireSeverity(severity);
+    if (!city.empty()) filter.requireCity(city);
+    if (!state.empty()) filter.requireState(state);
+    if (!zipcode.empty()) filter.requireZipcode(zipcode);
+    filter.compile(*store);
+    return find(filter);
 }
 
-// Helper function to find nodes that match the given criteria in the subtree rooted at the given node
-void RedBlackTree::findHelper(Node* node, int severity, const std::string& city, const std::string& state, const std::string& zipcode, std::vector<Node*>& result) {
-    if (node == nullptr)
-        return;
+// Find nodes that match a compiled filter in a single in-order pass, in ID order
+std::vector<Node*> RedBlackTree::find(const AccidentFilter& filter) const {
+    //the predicates are evaluated by column scans over the store, the walk only tests one bit per node
+    RowBitmap selected(store->size(), true);
+    filter.select(*store, selected);
+
+    //the walk is cut into morsels of in-order ranks, the subtree counts find the first node of a
+    //morsel without walking to it, and the matches of the morsels are put back in ID order at the end
+    constexpr size_t MORSEL_NODES = 8192;
+    std::vector<std::vector<std::pair<size_t, std::vector<Node*>>>> partial(workerCount());
+    parallelFor(static_cast<size_t>(getSize()), MORSEL_NODES, [&](size_t begin, size_t end, unsigned worker) {
+        std::vector<Node*> matches;
+        Node* node = nodeAtRank(begin);
+        for (size_t rank = begin; rank < end; ++rank, node = successor(node)) {
+            if (selected.test(node->row)) {
+                matches.push_back(node);
+            }
+        }
+        partial[worker].emplace_back(begin, std::move(matches));
+    });
 
-    if ((severity == 0 || node->severity == severity) &&
-        (city.empty() || node->city == city) &&
-        (state.empty() || node->state == state) &&
-        (zipcode.empty() || node->zipcode == zipcode)) {
-        result.push_back(node);
+    std::vector<std::pair<size_t, std::vector<Node*>>*> morsels;
+    for (auto& list : partial) {
+        for (auto& morsel : list) {
+            morsels.push_back(&morsel);
+        }
+    }
+    std::sort(morsels.begin(), morsels.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+    std::vector<Node*> result;
+    for (const auto* morsel : morsels) {
+        result.insert(result.end(), morsel->second.begin(), morsel->second.end());
     }
+    return result;
+}
 
-    findHelper(node->left, severity, city, state, zipcode, result);
-    findHelper(node->right, severity, city, state, zipcode, result);
+// Node with the given number of smaller IDs, found from the subtree counts in one descent
+Node* RedBlackTree::nodeAtRank(size_t rank) const {
+    Node* node = root;
+    while (node != nullptr) {
+        size_t leftCount = node->left != nullptr ? static_cast<size_t>(node->left->subtree.count) : 0;
+        if (rank < leftCount) {
+            node = node->left;
+        } else if (rank == leftCount) {
+            return node;
+        } else {
+            rank -= leftCount + 1;
+            node = node->right;
+        }
+    }
+    return nullptr;
 }
 
 // Remove a node with the given ID from the red-black tree
@@ -253,6 +413,7 @@ void RedBlackTree::remove(const std::string& id) {
         std::cout << "Node with ID " << id << " not found in the tree." << std::endl;
         return;
     }
+    ++version;
 
     Node* y = nodeToDelete;
     Node* x = nullptr;
@@ -261,17 +422,21 @@ void RedBlackTree::remove(const std::string& id) {
 
     if (nodeToDelete->left == nullptr) {
         x = nodeToDelete->right;
+        xParent = nodeToDelete->parent;
         transplant(nodeToDelete, nodeToDelete->right);
     } else if (nodeToDelete->right == nullptr) {
         x = nodeToDelete->left;
+        xParent = nodeToDelete->parent;
         transplant(nodeToDelete, nodeToDelete->left);
     } else {
         y = minimum(nodeToDelete->right);
         originalColor = y->color;
         x = y->right;
         if (y->parent == nodeToDelete) {
+            xParent = y;
             if (x != nullptr) x->parent = y;
         } else {
+            xParent = y->parent;
             transplant(y, y->right);
             y->right = nodeToDelete->right;
             if (y->right != nullptr) y->right->parent = y;
@@ -284,8 +449,19 @@ void RedBlackTree::remove(const std::string& id) {
 
     delete nodeToDelete;
 
+    //the nodes from where x hangs up to the root lost a record (or y moved among them)
+    for (Node* ancestor = xParent; ancestor != nullptr; ancestor = ancestor->parent) {
+        updateAggregate(ancestor);
+    }
+
     if (originalColor == BLACK) {
-        fixDelete(x);
+        fixDelete(x, xParent);
+    }
+
+    //the filter still holds the ID, it is rebuilt once too many of its IDs are gone
+    idFilter.noteRemove();
+    if (idFilter.needsRebuild()) {
+        rebuildFilter(2 * static_cast<size_t>(getSize()));
     }
 }
 
@@ -294,72 +470,255 @@ bool RedBlackTree::isEmpty() const {
     return root == nullptr;
 }
 
-// Get the number of nodes in the red-black tree
+// Get the number of nodes in the red-black tree, the root's totals already count them
 int RedBlackTree::getSize() const {
-    int count = 0;
-    std::function<void(Node*)> countNodes = [&](Node* node) {
-        if (node == nullptr) return;
-        count++;
-        countNodes(node->left);
-        countNodes(node->right);
-    };
-    countNodes(root);
-    return count;
+    return root == nullptr ? 0 : root->subtree.count;
+}
+
+// Version of the tree, it changes with every insert and remove
+uint64_t RedBlackTree::getVersion() const {
+    return version;
+}
+
+// Totals over the whole tree
+Aggregate RedBlackTree::aggregateAll() const {
+    return root == nullptr ? Aggregate() : root->subtree;
+}
+
+// Totals over the IDs between lo and hi (both included) without visiting the records. From the
+// node where the paths to lo and hi split, each boundary path adds the whole subtrees that fall
+// inside the range, so only O(log n) nodes are touched
+Aggregate RedBlackTree::aggregateRange(const std::string& lo, const std::string& hi) const {
+    Aggregate totals;
+    Node* split = root;
+    while (split != nullptr && (key(split) < lo || hi < key(split))) {
+        split = (key(split) < lo) ? split->right : split->left;
+    }
+    if (split == nullptr)
+        return totals;
+    totals.addRecord(store->severity(split->row), store->distance(split->row));
+
+    for (Node* node = split->left; node != nullptr;) {
+        if (key(node) < lo) {
+            node = node->right;
+        } else {
+            totals.addRecord(store->severity(node->row), store->distance(node->row));
+            if (node->right != nullptr) totals.add(node->right->subtree);
+            node = node->left;
+        }
+    }
+    for (Node* node = split->right; node != nullptr;) {
+        if (hi < key(node)) {
+            node = node->left;
+        } else {
+            totals.addRecord(store->severity(node->row), store->distance(node->row));
+            if (node->left != nullptr) totals.add(node->left->subtree);
+            node = node->right;
+        }
+    }
+    return totals;
 }
 
 // Search for nodes with the given severity in the red-black tree
 std::vector<Node*> RedBlackTree::searchBySeverity(int severity) const {
-    return const_cast<RedBlackTree*>(this)->find(severity, "", "", "");
+    return find(severity, "", "", "");
 }
 
 // Search for nodes with the given city in the red-black tree
 std::vector<Node*> RedBlackTree::searchByCity(const std::string& city) const {
-    return const_cast<RedBlackTree*>(this)->find(0, city, "", "");
+    return find(0, city, "", "");
 }
 
 // Search for nodes with the given state in the red-black tree
 std::vector<Node*> RedBlackTree::searchByState(const std::string& state) const {
-    return const_cast<RedBlackTree*>(this)->find(0, "", state, "");
+    return find(0, "", state, "");
 }
 
 // Search for nodes with the given zipcode in the red-black tree
 std::vector<Node*> RedBlackTree::searchByZipcode(const std::string& zipcode) const {
-    return const_cast<RedBlackTree*>(this)->find(0, "", "", zipcode);
+    return find(0, "", "", zipcode);
 }
 
 // Get all nodes in the red-black tree
 std::vector<Node*> RedBlackTree::getAllNodes() const {
     std::vector<Node*> nodes;
-    inorderTraversal(root, nodes);
+    for (Node& node : *this) {
+        nodes.push_back(&node);
+    }
     return nodes;
 }
 
-// Helper function to perform inorder traversal and collect nodes in the given vector
-void RedBlackTree::inorderTraversal(Node* node, std::vector<Node*>& nodes) const {
+// Iterator on the smallest ID
+RedBlackTree::iterator RedBlackTree::begin() const {
+    return iterator(this, root == nullptr ? nullptr : minimum(root));
+}
+
+// Iterator past the largest ID
+RedBlackTree::iterator RedBlackTree::end() const {
+    return iterator(this, nullptr);
+}
+
+// Iterator on the first ID that is not smaller than the given ID
+RedBlackTree::iterator RedBlackTree::lower_bound(const std::string& id) const {
+    return iterator(this, lowerBound(id));
+}
+
+// Iterator on the first ID that is greater than the given ID
+RedBlackTree::iterator RedBlackTree::upper_bound(const std::string& id) const {
+    Node* node = root;
+    Node* candidate = nullptr;
+    while (node != nullptr) {
+        if (id < key(node)) {
+            candidate = node;
+            node = node->left;
+        } else {
+            node = node->right;
+        }
+    }
+    return iterator(this, candidate);
+}
+
+// Move to the next ID
+RedBlackTree::iterator& RedBlackTree::iterator::operator++() {
+    node = successor(node);
+    return *this;
+}
+
+RedBlackTree::iterator RedBlackTree::iterator::operator++(int) {
+    iterator previous = *this;
+    ++(*this);
+    return previous;
+}
+
+// Move to the previous ID, from end() this is the largest ID
+RedBlackTree::iterator& RedBlackTree::iterator::operator--() {
     if (node == nullptr) {
-        return;
+        node = tree->root == nullptr ? nullptr : maximum(tree->root);
+    } else {
+        node = predecessor(node);
+    }
+    return *this;
+}
+
+RedBlackTree::iterator RedBlackTree::iterator::operator--(int) {
+    iterator previous = *this;
+    --(*this);
+    return previous;
+}
+
+// Find the first node whose ID is not smaller than the given ID, nullptr if there is none
+Node* RedBlackTree::lowerBound(const std::string& id) const {
+    Node* node = root;
+    Node* candidate = nullptr;
+    while (node != nullptr) {
+        if (key(node) < id) {
+            node = node->right;
+        } else {
+            candidate = node;
+            node = node->left;
+        }
     }
-    inorderTraversal(node->left, nodes);
-    nodes.push_back(node);
-    inorderTraversal(node->right, nodes);
+    return candidate;
+}
+
+// Next node in ID order, found through the parent pointers so no stack is needed
+Node* RedBlackTree::successor(Node* node) {
+    if (node->right != nullptr) {
+        return minimum(node->right);
+    }
+    Node* parent = node->parent;
+    while (parent != nullptr && node == parent->right) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return parent;
+}
+
+// Previous node in ID order, the mirror image of successor
+Node* RedBlackTree::predecessor(Node* node) {
+    if (node->left != nullptr) {
+        return maximum(node->left);
+    }
+    Node* parent = node->parent;
+    while (parent != nullptr && node == parent->left) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return parent;
+}
+
+// Cursor starting at the given node, it stops as soon as an ID falls past the bound
+RedBlackTree::Cursor::Cursor(const RecordStore* store, Node* start, std::string bound, bool isPrefix)
+        : store(store), node(nullptr), bound(std::move(bound)), isPrefix(isPrefix) {
+    if (start != nullptr && inBounds(start)) {
+        node = start;
+    }
+}
+
+// Check the upper end of the span, IDs come in order so the first miss ends the scan
+bool RedBlackTree::Cursor::inBounds(const Node* candidate) const {
+    std::string_view id = store->id(candidate->row);
+    if (isPrefix) {
+        return id.compare(0, bound.size(), bound) == 0;
+    }
+    return id <= bound;
+}
+
+// Move the cursor to the next ID of the span
+void RedBlackTree::Cursor::next() {
+    node = successor(node);
+    if (node != nullptr && !inBounds(node)) {
+        node = nullptr;
+    }
+}
+
+// Cursor over the IDs between lo and hi, both included
+RedBlackTree::Cursor RedBlackTree::rangeCursor(const std::string& lo, const std::string& hi) const {
+    return Cursor(store, lowerBound(lo), hi, false);
+}
+
+// Cursor over the IDs that start with the given prefix
+RedBlackTree::Cursor RedBlackTree::prefixCursor(const std::string& prefix) const {
+    return Cursor(store, lowerBound(prefix), prefix, true);
+}
+
+// Get the nodes with an ID between lo and hi (both included) in ID order
+std::vector<Node*> RedBlackTree::rangeScan(const std::string& lo, const std::string& hi) const {
+    std::vector<Node*> nodes;
+    for (Cursor cursor = rangeCursor(lo, hi); cursor.valid(); cursor.next()) {
+        nodes.push_back(cursor.get());
+    }
+    return nodes;
+}
+
+// Get the nodes whose ID starts with the given prefix in ID order
+std::vector<Node*> RedBlackTree::prefixScan(const std::string& prefix) const {
+    std::vector<Node*> nodes;
+    for (Cursor cursor = prefixCursor(prefix); cursor.valid(); cursor.next()) {
+        nodes.push_back(cursor.get());
+    }
+    return nodes;
 }
 
 // Filter nodes by severity from the given vector of nodes
 std::vector<Node*> RedBlackTree::filterBySeverity(const std::vector<Node*>& nodes, int severity) const {
     std::vector<Node*> filtered;
     for (const auto& node : nodes) {
-        if (node->severity == severity) {
+        if (store->severity(node->row) == severity) {
             filtered.push_back(node);
         }
     }
     return filtered;
 }
 
-// Filter nodes by city from the given vector of nodes
+// Filter nodes by city from the given vector of nodes, ignoring case
 std::vector<Node*> RedBlackTree::filterByCity(const std::vector<Node*>& nodes, const std::string& city) const {
     std::vector<Node*> filtered;
+    AccidentFilter byCity;
+    byCity.requireCity(city);
+    byCity.compile(*store);
     for (const auto& node : nodes) {
-        if (node->city == city) {
+        if (byCity.matches(*store, node->row)) {
             filtered.push_back(node);
         }
     }
@@ -369,19 +728,23 @@ std::vector<Node*> RedBlackTree::filterByCity(const std::vector<Node*>& nodes, c
 // Filter nodes by state from the given vector of nodes
 std::vector<Node*> RedBlackTree::filterByState(const std::vector<Node*>& nodes, const std::string& state) const {
     std::vector<Node*> filtered;
+    uint32_t code = store->states().lookup(state);
     for (const auto& node : nodes) {
-        if (node->state == state) {
+        if (store->stateCode(node->row) == code) {
             filtered.push_back(node);
         }
     }
     return filtered;
 }
 
-// Filter nodes by zipcode from the given vector of nodes
+// Filter nodes by zipcode from the given vector of nodes, a 5-digit zipcode also keeps its ZIP+4
 std::vector<Node*> RedBlackTree::filterByZipcode(const std::vector<Node*>& nodes, const std::string& zipcode) const {
     std::vector<Node*> filtered;
+    AccidentFilter byZipcode;
+    byZipcode.requireZipcode(zipcode);
+    byZipcode.compile(*store);
     for (const auto& node : nodes) {
-        if (node->zipcode == zipcode) {
+        if (byZipcode.matches(*store, node->row)) {
             filtered.push_back(node);
         }
     }
@@ -1,55 +1,135 @@
+#ifndef US_TRAFFIC_INCIDENTS_REDBLACKTREE_H
+#define US_TRAFFIC_INCIDENTS_REDBLACKTREE_H
+
 #include <iostream>
+#include <iterator>
 #include <string>
 #include <vector>
+#include "RecordStore.h"
+#include "AccidentFilter.h"
+#include "Aggregate.h"
+#include "OutputWriter.h"
+#include "IdFilter.h"
 
 enum Color { RED, BLACK };
 
+// Tree node, the accident itself is a row of the RecordStore the tree indexes
 struct Node {
-    std::string ID;
-    int severity;
-    double distance;
-    std::string city;
-    std::string state;
-    std::string zipcode;
+    RowId row;
     Color color;
     Node *left, *right, *parent;
+    Aggregate subtree;
 
-    Node(const std::string& id, int sev, double dist, const std::string& cty, const std::string& st, const std::string& zip)
-            : ID(id), severity(sev), distance(dist), city(cty), state(st), zipcode(zip), color(RED), left(nullptr), right(nullptr), parent(nullptr) {}
+    Node(RowId row, int sev, double dist) : row(row), color(RED), left(nullptr), right(nullptr), parent(nullptr) {
+        subtree.addRecord(sev, dist);
+    }
 };
 
 class RedBlackTree {
+public:
+    // Bidirectional in-order iterator, it moves through the parent pointers so it needs no stack
+    // and no allocation. end() is a null node, stepping back from it lands on the largest ID
+    class iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = Node;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Node*;
+        using reference = Node&;
+
+        iterator() : tree(nullptr), node(nullptr) {}
+        reference operator*() const { return *node; }
+        pointer operator->() const { return node; }
+        iterator& operator++();
+        iterator operator++(int);
+        iterator& operator--();
+        iterator operator--(int);
+        bool operator==(const iterator& other) const { return node == other.node; }
+        bool operator!=(const iterator& other) const { return node != other.node; }
+
+    private:
+        friend class RedBlackTree;
+        iterator(const RedBlackTree* tree, Node* node) : tree(tree), node(node) {}
+
+        const RedBlackTree* tree;
+        Node* node;
+    };
+    using const_iterator = iterator;
+
+    // Streaming cursor over the IDs of a range or a prefix, walks in order without building a vector
+    class Cursor {
+    public:
+        bool valid() const { return node != nullptr; }
+        Node* get() const { return node; }
+        void next();
+
+    private:
+        friend class RedBlackTree;
+        Cursor(const RecordStore* store, Node* start, std::string bound, bool isPrefix);
+        bool inBounds(const Node* candidate) const;
+
+        const RecordStore* store;
+        Node* node;
+        std::string bound;
+        bool isPrefix;
+    };
+
 private:
+    RecordStore* store;
     Node* root;
+    uint64_t version = 0; // bumped by every insert and remove that succeeds
+    IdFilter idFilter; // rejects most IDs that are not in the tree before the descent
+
+    std::string_view key(const Node* node) const { return store->id(node->row); }
 
     void rotateLeft(Node*& node);
     void rotateRight(Node*& node);
     void fixInsert(Node*& node);
-    void fixDelete(Node*& node);
-    Node* searchTreeHelper(Node* node, const std::string& id);
-    void inorderHelper(Node* node);
-    void findHelper(Node* node, int severity, const std::string& city, const std::string& state, const std::string& zipcode, std::vector<Node*>& result);
+    void fixDelete(Node* node, Node* parent);
+    void updateAggregate(Node* node) const;
     void transplant(Node* u, Node* v);
-    void inorderTraversal(Node* node, std::vector<Node*>& nodes) const;
+    Node* lowerBound(const std::string& id) const;
+    Node* nodeAtRank(size_t rank) const;
+    void rebuildFilter(size_t ids);
+    static Node* successor(Node* node);
+    static Node* predecessor(Node* node);
+    static Node* maximum(Node* node);
 
 public:
-    RedBlackTree();
+    explicit RedBlackTree(RecordStore& store);
     void insert(const std::string& id, int severity, double distance, const std::string& city, const std::string& state, const std::string& zipcode);
+    void insertRow(RowId row);
     void remove(const std::string& id);
-    Node* search(const std::string& id);
-    Node* minimum(Node* node);
-    void inorder();
-    std::vector<Node*> find(int severity, const std::string& city, const std::string& state, const std::string& zipcode);
+    void reserve(size_t ids);
+    Node* search(const std::string& id) const;
+    void multiGet(const std::vector<std::string>& ids, std::vector<Node*>& nodes) const;
+    static Node* minimum(Node* node);
+    void inorder(OutputWriter& out);
+    std::vector<Node*> find(int severity, const std::string& city, const std::string& state, const std::string& zipcode) const;
+    std::vector<Node*> find(const AccidentFilter& filter) const;
 
     bool isEmpty() const;
     int getSize() const;
+    uint64_t getVersion() const;
+    Aggregate aggregateAll() const;
+    Aggregate aggregateRange(const std::string& lo, const std::string& hi) const;
     std::vector<Node*> searchBySeverity(int severity) const;
     std::vector<Node*> searchByCity(const std::string& city) const;
     std::vector<Node*> searchByState(const std::string& state) const;
     std::vector<Node*> searchByZipcode(const std::string& zipcode) const;
     std::vector<Node*> getAllNodes() const;
+    iterator begin() const;
+    iterator end() const;
+    iterator lower_bound(const std::string& id) const;
+    iterator upper_bound(const std::string& id) const;
+    std::vector<Node*> rangeScan(const std::string& lo, const std::string& hi) const;
+    std::vector<Node*> prefixScan(const std::string& prefix) const;
+    Cursor rangeCursor(const std::string& lo, const std::string& hi) const;
+    Cursor prefixCursor(const std::string& prefix) const;
     std::vector<Node*> filterBySeverity(const std::vector<Node*>& nodes, int severity) const;
     std::vector<Node*> filterByCity(const std::vector<Node*>& nodes, const std::string& city) const;
     std::vector<Node*> filterByState(const std::vector<Node*>& nodes, const std::string& state) const;
     std::vector<Node*> filterByZipcode(const std::vector<Node*>& nodes, const std::string& zipcode) const;
 };
+
+#endif //US_TRAFFIC_INCIDENTS_REDBLACKTREE_H
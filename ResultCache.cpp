@@ -0,0 +1,86 @@
+#include "ResultCache.h"
+
+// Bookkeeping of an entry besides its rows and groups: the list node, the hash map node and the key twice
+constexpr size_t ENTRY_OVERHEAD = 128;
+
+ResultCache::ResultCache(size_t budget) : budget(budget) {}
+
+// Drop every entry when the data changed since they were computed
+void ResultCache::checkVersion(uint64_t current) {
+    if (current == version)
+        return;
+    counters.invalidations += entries.size();
+    entries.clear();
+    byKey.clear();
+    counters.bytes = 0;
+    version = current;
+}
+
+// Evict the least recently used entries until the results fit in the budget
+void ResultCache::evict() {
+    while (counters.bytes > budget && !entries.empty()) {
+        counters.bytes -= entries.back().bytes;
+        byKey.erase(entries.back().key);
+        entries.pop_back();
+        ++counters.evictions;
+    }
+}
+
+// Copy the result of the query out of the cache, false when it is not there or is stale
+bool ResultCache::find(const std::string& key, uint64_t current, Result& result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    checkVersion(current);
+    auto found = byKey.find(key);
+    if (found == byKey.end()) {
+        ++counters.misses;
+        return false;
+    }
+    entries.splice(entries.begin(), entries, found->second);
+    result = found->second->result;
+    ++counters.hits;
+    return true;
+}
+
+// Keep the result of the query computed on the given version, a result larger than the whole
+// budget is not kept
+void ResultCache::store(const std::string& key, uint64_t current, Result result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    checkVersion(current);
+    size_t bytes = ENTRY_OVERHEAD + 2 * key.size() + result.rows.size() * sizeof(RowId) + result.groups.size() * sizeof(Group);
+    if (bytes > budget)
+        return;
+    auto found = byKey.find(key);
+    if (found != byKey.end()) {
+        counters.bytes -= found->second->bytes;
+        entries.erase(found->second);
+        byKey.erase(found);
+    }
+    entries.push_front({key, std::move(result), bytes});
+    byKey[key] = entries.begin();
+    counters.bytes += bytes;
+    evict();
+}
+
+// Change the byte budget, evicting what no longer fits
+void ResultCache::setBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = bytes;
+    evict();
+}
+
+// Drop every entry, the counters are kept
+void ResultCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    byKey.clear();
+    counters.bytes = 0;
+}
+
+// Hit and miss counts and the memory held
+ResultCache::Stats ResultCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats current = counters;
+    current.entries = entries.size();
+    current.budget = budget;
+    return current;
+}
@@ -0,0 +1,66 @@
+#ifndef US_TRAFFIC_INCIDENTS_RESULTCACHE_H
+#define US_TRAFFIC_INCIDENTS_RESULTCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "RowId.h"
+#include "GroupBy.h"
+
+// Results of recent queries, the rows of a selection or the groups of an aggregation, under the
+// normalized text of the query. Every result is tagged with the version of the data it was
+// computed on, and the first lookup after an insert or a remove changed the version drops every
+// entry. The least recently used entries are evicted to keep the results under a byte budget
+class ResultCache {
+public:
+    static constexpr size_t DEFAULT_BUDGET = 64 * 1024 * 1024;
+
+    struct Result {
+        std::vector<RowId> rows;
+        std::vector<Group> groups;
+        size_t actualRows = 0; // rows the query selected, more than rows.size() for a top or a group-by
+    };
+
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+        size_t invalidations = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+        size_t budget = 0;
+
+        double hitRate() const { return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / (hits + misses); }
+    };
+
+    explicit ResultCache(size_t budget = DEFAULT_BUDGET);
+
+    bool find(const std::string& key, uint64_t version, Result& result);
+    void store(const std::string& key, uint64_t version, Result result);
+    void setBudget(size_t bytes);
+    void clear();
+    Stats stats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        Result result;
+        size_t bytes;
+    };
+
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> byKey;
+    uint64_t version = 0;
+    size_t budget;
+    Stats counters;
+    mutable std::mutex mutex;
+
+    void checkVersion(uint64_t current);
+    void evict();
+};
+
+#endif //US_TRAFFIC_INCIDENTS_RESULTCACHE_H
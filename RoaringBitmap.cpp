@@ -0,0 +1,134 @@
+#include "RoaringBitmap.h"
+#include <algorithm>
+
+// Check a low 16-bit value in a single chunk
+bool RoaringBitmap::Container::contains(uint16_t low) const {
+    if (isBitmap())
+        return (bits[low / 64] >> (low % 64) & 1) != 0;
+    return std::binary_search(values.begin(), values.end(), low);
+}
+
+// Chunk with the given high bits, nullptr when no row of the chunk is in the set
+const RoaringBitmap::Container* RoaringBitmap::find(uint16_t key) const {
+    auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    return (it != containers.end() && it->key == key) ? &*it : nullptr;
+}
+
+// Add a row, rows mostly arrive in increasing order so the array insert is usually an append
+void RoaringBitmap::add(RowId row) {
+    auto key = static_cast<uint16_t>(row >> 16);
+    auto low = static_cast<uint16_t>(row & 0xFFFF);
+
+    auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    if (it == containers.end() || it->key != key) {
+        it = containers.insert(it, Container{key, 0, {}, {}});
+    }
+    Container& c = *it;
+
+    if (c.isBitmap()) {
+        uint64_t bit = uint64_t(1) << (low % 64);
+        if ((c.bits[low / 64] & bit) == 0) {
+            c.bits[low / 64] |= bit;
+            ++c.cardinality;
+        }
+        return;
+    }
+
+    auto pos = std::lower_bound(c.values.begin(), c.values.end(), low);
+    if (pos != c.values.end() && *pos == low)
+        return;
+    c.values.insert(pos, low);
+    ++c.cardinality;
+
+    //past the limit the array takes more room than the bitmap, switch the chunk over
+    if (c.cardinality > ARRAY_LIMIT) {
+        c.bits.assign(CHUNK_WORDS, 0);
+        for (uint16_t value : c.values) {
+            c.bits[value / 64] |= uint64_t(1) << (value % 64);
+        }
+        std::vector<uint16_t>().swap(c.values);
+    }
+}
+
+// Check if a row is in the set
+bool RoaringBitmap::contains(RowId row) const {
+    const Container* c = find(static_cast<uint16_t>(row >> 16));
+    return c != nullptr && c->contains(static_cast<uint16_t>(row & 0xFFFF));
+}
+
+// Number of rows in the set, each chunk keeps its own count
+size_t RoaringBitmap::cardinality() const {
+    size_t total = 0;
+    for (const auto& c : containers) {
+        total += c.cardinality;
+    }
+    return total;
+}
+
+// Bytes used by the chunks
+size_t RoaringBitmap::memoryBytes() const {
+    size_t total = containers.capacity() * sizeof(Container);
+    for (const auto& c : containers) {
+        total += c.values.capacity() * sizeof(uint16_t) + c.bits.capacity() * sizeof(uint64_t);
+    }
+    return total;
+}
+
+// Clear in a RowBitmap every row that is not in this set
+void RoaringBitmap::andInto(RowBitmap& rows) const {
+    uint64_t* words = rows.data();
+    size_t wordCount = rows.wordCount();
+    size_t next = 0; // first word not handled yet
+
+    for (const auto& c : containers) {
+        size_t first = size_t(c.key) * CHUNK_WORDS;
+        if (first >= wordCount)
+            break;
+        size_t last = std::min(first + CHUNK_WORDS, wordCount);
+
+        //chunks with no container have no row in the set
+        std::fill(words + next, words + first, 0);
+
+        if (c.isBitmap()) {
+            for (size_t w = first; w < last; ++w) {
+                words[w] &= c.bits[w - first];
+            }
+        } else {
+            //keep only the bits of the array values, building the chunk back from them
+            std::vector<uint64_t> kept(last - first, 0);
+            for (uint16_t value : c.values) {
+                size_t w = value / 64;
+                if (w < kept.size()) {
+                    kept[w] |= words[first + w] & (uint64_t(1) << (value % 64));
+                }
+            }
+            std::copy(kept.begin(), kept.end(), words + first);
+        }
+        next = last;
+    }
+    std::fill(words + next, words + wordCount, 0);
+}
+
+// Add a row under its value
+void BitmapIndex::add(uint32_t value, RowId row) {
+    if (value >= bitmaps.size()) {
+        bitmaps.resize(value + 1);
+    }
+    bitmaps[value].add(row);
+}
+
+// Rows with the given value, nullptr when no row has it
+const RoaringBitmap* BitmapIndex::rows(uint32_t value) const {
+    return value < bitmaps.size() ? &bitmaps[value] : nullptr;
+}
+
+// Bytes used by all the bitmaps
+size_t BitmapIndex::memoryBytes() const {
+    size_t total = bitmaps.capacity() * sizeof(RoaringBitmap);
+    for (const auto& bitmap : bitmaps) {
+        total += bitmap.memoryBytes();
+    }
+    return total;
+}
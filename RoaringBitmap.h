@@ -0,0 +1,52 @@
+#ifndef US_TRAFFIC_INCIDENTS_ROARINGBITMAP_H
+#define US_TRAFFIC_INCIDENTS_ROARINGBITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "RowId.h"
+#include "RowBitmap.h"
+
+// Compressed set of rows in the roaring layout: the rows are split in chunks of 65536 by their
+// high 16 bits, and each chunk keeps its low 16 bits either as a sorted array (sparse chunks,
+// 2 bytes per row) or as a 8 KB bitmap once it holds more than 4096 rows
+class RoaringBitmap {
+public:
+    static constexpr uint32_t ARRAY_LIMIT = 4096;
+    static constexpr size_t CHUNK_WORDS = 65536 / 64;
+
+    void add(RowId row);
+    bool contains(RowId row) const;
+    size_t cardinality() const;
+    size_t memoryBytes() const;
+
+    void andInto(RowBitmap& rows) const;
+
+private:
+    struct Container {
+        uint16_t key;
+        uint32_t cardinality;
+        std::vector<uint16_t> values; // sorted low bits while the chunk is sparse
+        std::vector<uint64_t> bits;   // CHUNK_WORDS words once it is dense
+
+        bool isBitmap() const { return !bits.empty(); }
+        bool contains(uint16_t low) const;
+    };
+
+    std::vector<Container> containers; // sorted by key
+
+    const Container* find(uint16_t key) const;
+};
+
+// Bitmap index over a low-cardinality column, one roaring bitmap with the rows of each value
+class BitmapIndex {
+public:
+    void add(uint32_t value, RowId row);
+    const RoaringBitmap* rows(uint32_t value) const;
+    size_t memoryBytes() const;
+
+private:
+    std::vector<RoaringBitmap> bitmaps; // indexed by value
+};
+
+#endif //US_TRAFFIC_INCIDENTS_ROARINGBITMAP_H
@@ -0,0 +1,70 @@
+#include "RowBitmap.h"
+#include <algorithm>
+
+// Bitmap over the given number of rows, all selected or none
+RowBitmap::RowBitmap(size_t rows, bool selected) {
+    resize(rows);
+    if (selected) {
+        for (auto& word : words) {
+            word = ~uint64_t(0);
+        }
+        //the bits past the last row stay clear so count() is exact
+        if (rows % 64 != 0) {
+            words.back() = (uint64_t(1) << (rows % 64)) - 1;
+        }
+    }
+}
+
+// Grow or shrink to the given number of rows, new rows are not selected
+void RowBitmap::resize(size_t rows) {
+    words.resize((rows + 63) / 64, 0);
+    if (rows < bits && rows % 64 != 0) {
+        words.back() &= (uint64_t(1) << (rows % 64)) - 1;
+    }
+    bits = rows;
+}
+
+// Deselect every row
+void RowBitmap::clear() {
+    for (auto& word : words) {
+        word = 0;
+    }
+}
+
+// Keep selected only the given rows, in increasing order, of those already selected. Only the
+// words that hold one of them are masked, the words in between are cleared whole
+void RowBitmap::keepOnly(const std::vector<RowId>& rows) {
+    size_t cleared = 0; // the words before this one are done
+    for (size_t i = 0; i < rows.size() && rows[i] / 64 < words.size();) {
+        size_t w = rows[i] / 64;
+        uint64_t keep = 0;
+        for (; i < rows.size() && rows[i] / 64 == w; ++i) {
+            keep |= uint64_t(1) << (rows[i] % 64);
+        }
+        std::fill(words.begin() + cleared, words.begin() + w, 0);
+        words[w] &= keep;
+        cleared = w + 1;
+    }
+    std::fill(words.begin() + cleared, words.end(), 0);
+}
+
+// Number of selected rows
+size_t RowBitmap::count() const {
+    size_t total = 0;
+    for (uint64_t word : words) {
+        total += __builtin_popcountll(word);
+    }
+    return total;
+}
+
+// Selection vector with the selected rows in increasing order
+std::vector<RowId> RowBitmap::rows() const {
+    std::vector<RowId> selected;
+    selected.reserve(count());
+    for (size_t w = 0; w < words.size(); ++w) {
+        for (uint64_t word = words[w]; word != 0; word &= word - 1) {
+            selected.push_back(static_cast<RowId>(w * 64 + __builtin_ctzll(word)));
+        }
+    }
+    return selected;
+}
@@ -0,0 +1,36 @@
+#ifndef US_TRAFFIC_INCIDENTS_ROWBITMAP_H
+#define US_TRAFFIC_INCIDENTS_ROWBITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "RowId.h"
+
+// One bit per row of a RecordStore, bit r of word r / 64 is set when row r is selected.
+// The scan kernels clear the bits of the rows a predicate rejects, 64 rows per word
+class RowBitmap {
+public:
+    RowBitmap() = default;
+    explicit RowBitmap(size_t rows, bool selected = false);
+
+    void resize(size_t rows);
+    void set(RowId row) { words[row / 64] |= uint64_t(1) << (row % 64); }
+    void reset(RowId row) { words[row / 64] &= ~(uint64_t(1) << (row % 64)); }
+    bool test(RowId row) const { return row < bits && (words[row / 64] >> (row % 64) & 1) != 0; }
+    void clear();
+    void keepOnly(const std::vector<RowId>& rows);
+
+    size_t size() const { return bits; }
+    size_t wordCount() const { return words.size(); }
+    uint64_t* data() { return words.data(); }
+    const uint64_t* data() const { return words.data(); }
+
+    size_t count() const;
+    std::vector<RowId> rows() const;
+
+private:
+    std::vector<uint64_t> words;
+    size_t bits = 0;
+};
+
+#endif //US_TRAFFIC_INCIDENTS_ROWBITMAP_H
@@ -0,0 +1,10 @@
+#ifndef US_TRAFFIC_INCIDENTS_ROWID_H
+#define US_TRAFFIC_INCIDENTS_ROWID_H
+
+#include <cstdint>
+
+// Rows are addressed by their position in the store
+using RowId = uint32_t;
+constexpr RowId NO_ROW = UINT32_MAX;
+
+#endif //US_TRAFFIC_INCIDENTS_ROWID_H
@@ -0,0 +1,164 @@
+#include "ScanKernels.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SCAN_X86 1
+#include <immintrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// Match mask of up to 64 values, bit i is set when column[i] equals the key
+template <typename T>
+static uint64_t matchScalar(const T* column, size_t count, T key) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < count; ++i) {
+        mask |= uint64_t(column[i] == key) << i;
+    }
+    return mask;
+}
+
+// Match mask of up to 64 values, bit i is set when column[i] is inside the range
+static uint64_t matchBetweenScalar(const double* column, size_t count, double low, double high) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < count; ++i) {
+        mask |= uint64_t(column[i] >= low && column[i] <= high) << i;
+    }
+    return mask;
+}
+
+#ifndef SCAN_X86
+
+static void scanBetweenScalar(const double* column, size_t fullWords, double low, double high, uint64_t* words) {
+    for (size_t w = 0; w < fullWords; ++w) {
+        if (words[w] != 0) {
+            words[w] &= matchBetweenScalar(column + w * 64, 64, low, high);
+        }
+    }
+}
+
+// Scalar loop over the whole words for the other architectures
+template <typename T>
+static void scanScalar(const T* column, size_t fullWords, T key, uint64_t* words) {
+    for (size_t w = 0; w < fullWords; ++w) {
+        if (words[w] != 0) {
+            words[w] &= matchScalar(column + w * 64, 64, key);
+        }
+    }
+}
+
+#else
+
+//SSE2 is part of x86-64, so these need no check: 4 values per compare
+static void scanSse2(const uint32_t* column, size_t fullWords, uint32_t key, uint64_t* words) {
+    const __m128i k = _mm_set1_epi32(static_cast<int>(key));
+    for (size_t w = 0; w < fullWords; ++w) {
+        if (words[w] == 0) continue;
+        const auto* v = reinterpret_cast<const __m128i*>(column + w * 64);
+        uint64_t mask = 0;
+        for (int i = 0; i < 16; ++i) {
+            __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128(v + i), k);
+            mask |= uint64_t(_mm_movemask_ps(_mm_castsi128_ps(eq))) << (4 * i);
+        }
+        words[w] &= mask;
+    }
+}
+
+//two doubles per compare, NaN distances fail both compares like in the scalar loop
+static void scanBetweenSse2(const double* column, size_t fullWords, double low, double high, uint64_t* words) {
+    const __m128d lo = _mm_set1_pd(low);
+    const __m128d hi = _mm_set1_pd(high);
+    for (size_t w = 0; w < fullWords; ++w) {
+        if (words[w] == 0) continue;
+        const double* v = column + w * 64;
+        uint64_t mask = 0;
+        for (int i = 0; i < 32; ++i) {
+            __m128d x = _mm_loadu_pd(v + 2 * i);
+            __m128d in = _mm_and_pd(_mm_cmpge_pd(x, lo), _mm_cmple_pd(x, hi));
+            mask |= uint64_t(_mm_movemask_pd(in)) << (2 * i);
+        }
+        words[w] &= mask;
+    }
+}
+
+//AVX2: 8 values per compare
+TARGET_AVX2 static void scanAvx2(const uint32_t* column, size_t fullWords, uint32_t key, uint64_t* words) {
+    const __m256i k = _mm256_set1_epi32(static_cast<int>(key));
+    for (size_t w = 0; w < fullWords; ++w) {
+        if (words[w] == 0) continue;
+        const auto* v = reinterpret_cast<const __m256i*>(column + w * 64);
+        uint64_t mask = 0;
+        for (int i = 0; i < 8; ++i) {
+            __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256(v + i), k);
+            mask |= uint64_t(_mm256_movemask_ps(_mm256_castsi256_ps(eq))) << (8 * i);
+        }
+        words[w] &= mask;
+    }
+}
+
+TARGET_AVX2 static void scanBetweenAvx2(const double* column, size_t fullWords, double low, double high, uint64_t* words) {
+    const __m256d lo = _mm256_set1_pd(low);
+    const __m256d hi = _mm256_set1_pd(high);
+    for (size_t w = 0; w < fullWords; ++w) {
+        if (words[w] == 0) continue;
+        const double* v = column + w * 64;
+        uint64_t mask = 0;
+        for (int i = 0; i < 16; ++i) {
+            __m256d x = _mm256_loadu_pd(v + 4 * i);
+            __m256d in = _mm256_and_pd(_mm256_cmp_pd(x, lo, _CMP_GE_OQ), _mm256_cmp_pd(x, hi, _CMP_LE_OQ));
+            mask |= uint64_t(_mm256_movemask_pd(in)) << (4 * i);
+        }
+        words[w] &= mask;
+    }
+}
+
+static bool hasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+#endif
+
+// Run the best kernel over the whole words and finish the last partial word with the scalar loop
+template <typename T>
+static void scan(const T* column, size_t rows, T key, uint64_t* words) {
+    size_t fullWords = rows / 64;
+#ifdef SCAN_X86
+    if (hasAvx2()) {
+        scanAvx2(column, fullWords, key, words);
+    } else {
+        scanSse2(column, fullWords, key, words);
+    }
+#else
+    scanScalar(column, fullWords, key, words);
+#endif
+    if (rows % 64 != 0) {
+        words[fullWords] &= matchScalar(column + fullWords * 64, rows % 64, key);
+    }
+}
+
+void scanAndEqual(const uint32_t* column, size_t rows, uint32_t key, uint64_t* words) {
+    scan(column, rows, key, words);
+}
+
+void scanAndBetween(const double* column, size_t rows, double low, double high, uint64_t* words) {
+    size_t fullWords = rows / 64;
+#ifdef SCAN_X86
+    if (hasAvx2()) {
+        scanBetweenAvx2(column, fullWords, low, high, words);
+    } else {
+        scanBetweenSse2(column, fullWords, low, high, words);
+    }
+#else
+    scanBetweenScalar(column, fullWords, low, high, words);
+#endif
+    if (rows % 64 != 0) {
+        words[fullWords] &= matchBetweenScalar(column + fullWords * 64, rows % 64, low, high);
+    }
+}
+
+const char* scanInstructionSet() {
+#ifdef SCAN_X86
+    return hasAvx2() ? "AVX2" : "SSE2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,21 @@
+#ifndef US_TRAFFIC_INCIDENTS_SCANKERNELS_H
+#define US_TRAFFIC_INCIDENTS_SCANKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Equality scan over a code column of the RecordStore, the zipcodes (severity and state are
+// answered by their bitmap indexes). The kernel compares the column with the key 64 rows at a time
+// and clears the bit of every row that does not match in the bitmap words (one bit per row, as in
+// RowBitmap), so chaining kernels ANDs the predicates. Words that are already zero are skipped.
+// The AVX2 version is picked at runtime when the CPU has it, SSE2 is used otherwise on x86-64 and
+// a scalar loop everywhere else
+void scanAndEqual(const uint32_t* column, size_t rows, uint32_t key, uint64_t* words);
+
+// Same for a range, keeps the rows with low <= column[row] <= high
+void scanAndBetween(const double* column, size_t rows, double low, double high, uint64_t* words);
+
+// Name of the instruction set the kernels run with on this machine
+const char* scanInstructionSet();
+
+#endif //US_TRAFFIC_INCIDENTS_SCANKERNELS_H
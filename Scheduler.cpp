@@ -0,0 +1,140 @@
+#include "Scheduler.h"
+#include <algorithm>
+#include "Parallel.h"
+
+// The scheduler of the process, its helper threads start on first use, one per hardware thread
+// besides the one running the job
+TaskScheduler& TaskScheduler::instance() {
+    static TaskScheduler scheduler(workerCount() - 1);
+    return scheduler;
+}
+
+TaskScheduler::TaskScheduler(unsigned helpers) {
+    for (unsigned i = 0; i < helpers; ++i) {
+        threads.emplace_back([this] { help(); });
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// Loop of a helper thread: join the oldest job that still takes helpers
+void TaskScheduler::help() {
+    while (true) {
+        std::shared_ptr<Job> job;
+        unsigned worker;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping)
+                return;
+            job = jobs.front();
+            worker = job->joined.fetch_add(1);
+            //the last share is taken, the next helpers go to the next job
+            if (worker + 1 >= job->shares.size()) {
+                jobs.pop_front();
+            }
+        }
+        if (worker < job->shares.size()) {
+            work(*job, worker);
+        }
+    }
+}
+
+// Stop offering a job to the helpers
+void TaskScheduler::retire(const std::shared_ptr<Job>& job) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = std::find(jobs.begin(), jobs.end(), job);
+    if (found != jobs.end()) {
+        jobs.erase(found);
+    }
+}
+
+// Next morsel of the worker's own share
+bool TaskScheduler::take(Job& job, unsigned worker, size_t& begin, size_t& end) {
+    Share& share = job.shares[worker];
+    std::lock_guard<std::mutex> lock(share.mutex);
+    if (share.begin >= share.end)
+        return false;
+    begin = share.begin;
+    end = std::min(share.end, begin + job.morsel);
+    share.begin = end;
+    return true;
+}
+
+// Move the back half of the morsels of another share (all of it when it has one left) into the
+// thief's share, false when every share is used up
+bool TaskScheduler::steal(Job& job, unsigned thief) {
+    auto shares = static_cast<unsigned>(job.shares.size());
+    for (unsigned offset = 1; offset < shares; ++offset) {
+        Share& victim = job.shares[(thief + offset) % shares];
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.begin >= victim.end)
+                continue;
+            size_t morsels = (victim.end - victim.begin + job.morsel - 1) / job.morsel;
+            begin = morsels == 1 ? victim.begin : victim.begin + (morsels - morsels / 2) * job.morsel;
+            end = victim.end;
+            victim.end = begin;
+        }
+        Share& own = job.shares[thief];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.begin = begin;
+        own.end = end;
+        return true;
+    }
+    return false;
+}
+
+// Run morsels of the job until none is left to take or to steal
+void TaskScheduler::work(Job& job, unsigned worker) {
+    size_t begin, end;
+    while (take(job, worker, begin, end) || (steal(job, worker) && take(job, worker, begin, end))) {
+        (*job.body)(begin, end, worker);
+        if (job.done.fetch_add(end - begin) + (end - begin) == job.count) {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            job.finished.notify_all();
+        }
+    }
+}
+
+// Run body over [0, count) in morsels of the given size, worker is below participants() and two
+// morsels with the same worker never run at the same time. Returns once every morsel is done
+void TaskScheduler::run(size_t count, size_t morsel, const Body& body) {
+    morsel = std::max<size_t>(morsel, 1);
+    size_t morsels = (count + morsel - 1) / morsel;
+    auto workers = static_cast<unsigned>(std::min<size_t>(participants(), morsels));
+    if (workers <= 1) {
+        if (count > 0) {
+            body(0, count, 0);
+        }
+        return;
+    }
+
+    auto job = std::make_shared<Job>(&body, count, morsel, workers);
+    for (unsigned w = 0; w < workers; ++w) {
+        job->shares[w].begin = std::min(count, morsels * w / workers * morsel);
+        job->shares[w].end = std::min(count, morsels * (w + 1) / workers * morsel);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(job);
+    }
+    for (unsigned w = 1; w < workers; ++w) {
+        wake.notify_one();
+    }
+
+    work(*job, 0);
+    retire(job);
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&job] { return job->done.load() == job->count; });
+}
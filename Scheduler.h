@@ -0,0 +1,67 @@
+#ifndef US_TRAFFIC_INCIDENTS_SCHEDULER_H
+#define US_TRAFFIC_INCIDENTS_SCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing scheduler for the parallel scans. A job is a range of items cut into morsels of a
+// fixed size. Every thread that joins the job starts with its own contiguous share of the range
+// and takes morsels from its front; a thread whose share is used up steals the back half of the
+// share of another, so a thread slowed by a costlier part of the data is helped instead of waited
+// for. The threads are started once and kept, the thread that runs a job works on it too, and jobs
+// of different callers can run at the same time
+class TaskScheduler {
+public:
+    using Body = std::function<void(size_t begin, size_t end, unsigned worker)>;
+
+    static TaskScheduler& instance();
+    ~TaskScheduler();
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    unsigned participants() const { return static_cast<unsigned>(threads.size()) + 1; }
+    void run(size_t count, size_t morsel, const Body& body);
+
+private:
+    struct Share {
+        std::mutex mutex;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    struct Job {
+        const Body* body;
+        size_t count;
+        size_t morsel;
+        std::vector<Share> shares; // one per thread that may join, the caller has share 0
+        std::atomic<unsigned> joined{1};
+        std::atomic<size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+
+        Job(const Body* body, size_t count, size_t morsel, unsigned workers)
+                : body(body), count(count), morsel(morsel), shares(workers) {}
+    };
+
+    std::vector<std::thread> threads;
+    std::deque<std::shared_ptr<Job>> jobs; // jobs that still take helpers
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    explicit TaskScheduler(unsigned helpers);
+    void help();
+    void retire(const std::shared_ptr<Job>& job);
+    static void work(Job& job, unsigned worker);
+    static bool take(Job& job, unsigned worker, size_t& begin, size_t& end);
+    static bool steal(Job& job, unsigned thief);
+};
+
+#endif //US_TRAFFIC_INCIDENTS_SCHEDULER_H
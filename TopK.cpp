@@ -0,0 +1,50 @@
+#include "TopK.h"
+#include <cmath>
+#include "Parallel.h"
+
+// Bitmap words (64 rows each) in a morsel of the scheduler, 16K rows
+constexpr size_t MORSEL_WORDS = 256;
+
+// Rank by distance, longest first, ties go to the row appended first so the result is stable. A
+// NaN distance ranks after every number, NaNs among themselves by row, so the order stays strict
+bool TopK::longerDistance(const RecordStore& store, RowId a, RowId b) {
+    double distanceA = store.distance(a), distanceB = store.distance(b);
+    bool nanA = std::isnan(distanceA), nanB = std::isnan(distanceB);
+    if (nanA || nanB) {
+        return nanA != nanB ? nanB : a < b;
+    }
+    return distanceA != distanceB ? distanceA > distanceB : a < b;
+}
+
+// The k selected rows with the longest distance, longest first. Every thread keeps a heap of k
+// rows for the morsels of the bitmap it takes and the heaps are merged at the end
+std::vector<RowId> TopK::longest(const RecordStore& store, const RowBitmap& rows, size_t k) {
+    auto better = [&store](RowId a, RowId b) { return longerDistance(store, a, b); };
+    using Heap = BoundedHeap<RowId, decltype(better)>;
+    const uint64_t* words = rows.data();
+    std::vector<Heap> partial(workerCount(), Heap(k, better));
+
+    parallelFor(rows.wordCount(), MORSEL_WORDS, [&](size_t begin, size_t end, unsigned worker) {
+        Heap& heap = partial[worker];
+        for (size_t w = begin; w < end; ++w) {
+            for (uint64_t word = words[w]; word != 0; word &= word - 1) {
+                heap.push(static_cast<RowId>(w * 64 + __builtin_ctzll(word)));
+            }
+        }
+    });
+
+    Heap merged(k, better);
+    for (const auto& heap : partial) {
+        merged.merge(heap);
+    }
+    return merged.sorted();
+}
+
+// The k groups with the most rows, in the order GroupBy::run lists them
+std::vector<Group> TopK::largest(const std::vector<Group>& groups, size_t k) {
+    BoundedHeap<Group, bool (*)(const Group&, const Group&)> heap(k, GroupBy::ranksBefore);
+    for (const auto& group : groups) {
+        heap.push(group);
+    }
+    return heap.sorted();
+}
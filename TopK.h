@@ -0,0 +1,60 @@
+#ifndef US_TRAFFIC_INCIDENTS_TOPK_H
+#define US_TRAFFIC_INCIDENTS_TOPK_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "RecordStore.h"
+#include "RowBitmap.h"
+#include "GroupBy.h"
+
+// Keeps the k best items pushed into it and nothing else. better(a, b) is true when a ranks
+// before b, the heap is ordered so its front is the worst item kept, the one the next better
+// item replaces
+template <typename T, typename Better>
+class BoundedHeap {
+public:
+    BoundedHeap(size_t k, Better better) : k(k), better(better) {
+        items.reserve(std::min<size_t>(k, 4096));
+    }
+
+    void push(const T& item) {
+        if (items.size() < k) {
+            items.push_back(item);
+            std::push_heap(items.begin(), items.end(), better);
+        } else if (k > 0 && better(item, items.front())) {
+            std::pop_heap(items.begin(), items.end(), better);
+            items.back() = item;
+            std::push_heap(items.begin(), items.end(), better);
+        }
+    }
+
+    void merge(const BoundedHeap& other) {
+        for (const T& item : other.items) {
+            push(item);
+        }
+    }
+
+    // The kept items, best first
+    std::vector<T> sorted() const {
+        std::vector<T> result = items;
+        std::sort_heap(result.begin(), result.end(), better);
+        return result;
+    }
+
+private:
+    size_t k;
+    Better better;
+    std::vector<T> items;
+};
+
+// Top-K operators: they keep k items while the input streams by instead of collecting and
+// sorting every match, so they need memory for k items (k per thread when run in parallel)
+class TopK {
+public:
+    static bool longerDistance(const RecordStore& store, RowId a, RowId b);
+    static std::vector<RowId> longest(const RecordStore& store, const RowBitmap& rows, size_t k);
+    static std::vector<Group> largest(const std::vector<Group>& groups, size_t k);
+};
+
+#endif //US_TRAFFIC_INCIDENTS_TOPK_H
@@ -1,3 +1,6 @@
+#ifndef US_TRAFFIC_INCIDENTS_TRAFFICACCIDENT_H
+#define US_TRAFFIC_INCIDENTS_TRAFFICACCIDENT_H
+
 #include <string>
 
 using namespace std;
@@ -16,4 +19,6 @@ public:
 
     TrafficAccident(std::string id, int severity, double distance, std::string city, std::string state, std::string zipcode)
             : ID(std::move(id)), severity(severity), distance(distance), city(std::move(city)), state(std::move(state)), zipcode(std::move(zipcode)) {}
-};
\ No newline at end of file
+};
+
+#endif //US_TRAFFIC_INCIDENTS_TRAFFICACCIDENT_H
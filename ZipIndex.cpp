@@ -0,0 +1,146 @@
+#include "ZipIndex.h"
+#include <algorithm>
+#include <cctype>
+
+// Fewest pending rows worth a merge on append, a lookup merges whatever is pending
+constexpr size_t MIN_PENDING = 1024;
+
+// True when the text is count digits starting at position start
+static bool digitsAt(const std::string& text, size_t start, size_t count) {
+    if (start + count > text.size())
+        return false;
+    for (size_t i = start; i < start + count; ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(text[i])))
+            return false;
+    }
+    return true;
+}
+
+// Read the 5 digits of a zipcode and the 4 extra digits of a ZIP+4 (written 70791-4610 or
+// 707914610), plus4 is -1 when there are none. False when the text is anything else
+static bool parseZipcode(const std::string& zipcode, uint32_t& zip5, int& plus4) {
+    if (!digitsAt(zipcode, 0, 5))
+        return false;
+    zip5 = std::stoul(zipcode.substr(0, 5));
+    plus4 = -1;
+    if (zipcode.size() == 5)
+        return true;
+    size_t start = zipcode.size() == 10 && zipcode[5] == '-' ? 6 : 5;
+    if (zipcode.size() != start + 4 || !digitsAt(zipcode, start, 4))
+        return false;
+    plus4 = std::stoi(zipcode.substr(start, 4));
+    return true;
+}
+
+// Key of the zipcode of a row. A ZIP+4 with a garbled extension (93247-94ND in the data) keeps its
+// 5 digits, NO_KEY when there are not even those
+uint32_t ZipIndex::key(const std::string& zipcode) {
+    uint32_t zip5 = 0;
+    int plus4;
+    if (parseZipcode(zipcode, zip5, plus4))
+        return zip5 * KEYS_PER_ZIP5 + static_cast<uint32_t>(plus4 + 1);
+    return digitsAt(zipcode, 0, 5) ? zip5 * KEYS_PER_ZIP5 : NO_KEY;
+}
+
+// Keys a zipcode query covers: 1 to 5 digits are a prefix that also takes in the ZIP+4 under it
+// (3 digits are a sectional center), a ZIP+4 is only itself. False when the text is neither
+bool ZipIndex::range(const std::string& zipcode, uint32_t& low, uint32_t& high) {
+    if (!zipcode.empty() && zipcode.size() <= 5 && digitsAt(zipcode, 0, zipcode.size())) {
+        uint32_t scale = 1;
+        for (size_t i = zipcode.size(); i < 5; ++i) {
+            scale *= 10;
+        }
+        uint32_t prefix = std::stoul(zipcode);
+        low = prefix * scale * KEYS_PER_ZIP5;
+        high = (prefix + 1) * scale * KEYS_PER_ZIP5 - 1;
+        return true;
+    }
+    uint32_t zip5;
+    int plus4;
+    if (!parseZipcode(zipcode, zip5, plus4))
+        return false;
+    low = high = zip5 * KEYS_PER_ZIP5 + static_cast<uint32_t>(plus4 + 1);
+    return true;
+}
+
+// Add a row, it is only sorted into the main array by the next merge
+void ZipIndex::add(uint32_t key, RowId row) {
+    pending.push_back({key, row});
+    if (pending.size() >= std::max(MIN_PENDING, sorted.size() / 8)) {
+        merge();
+    }
+}
+
+// Number of rows indexed
+size_t ZipIndex::size() const {
+    return sorted.size() + pending.size();
+}
+
+// Sort the pending rows and merge them into the main array, then rebuild the directory
+void ZipIndex::merge() const {
+    auto byKey = [](const Entry& a, const Entry& b) {
+        return a.key != b.key ? a.key < b.key : a.row < b.row;
+    };
+    std::sort(pending.begin(), pending.end(), byKey);
+    size_t middle = sorted.size();
+    sorted.insert(sorted.end(), pending.begin(), pending.end());
+    std::inplace_merge(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(middle), sorted.end(), byKey);
+    pending.clear();
+
+    //offsets[z] is the first entry with a 5-digit zipcode of at least z
+    offsets.assign(ZIP5_COUNT + 1, 0);
+    for (const auto& entry : sorted) {
+        ++offsets[entry.key / KEYS_PER_ZIP5 + 1];
+    }
+    for (uint32_t zip5 = 0; zip5 < ZIP5_COUNT; ++zip5) {
+        offsets[zip5 + 1] += offsets[zip5];
+    }
+}
+
+// Entries [first, last) of the main array with a key between low and high. The directory gives the
+// 5-digit zipcodes at both ends, only a range that starts or ends inside one (a ZIP+4) needs a
+// binary search, and that only among the rows of that zipcode. The pending rows are merged first
+void ZipIndex::bounds(uint32_t low, uint32_t high, size_t& first, size_t& last) const {
+    {
+        std::lock_guard<std::mutex> lock(mergeLock);
+        if (!pending.empty()) {
+            merge();
+        }
+    }
+    first = last = 0;
+    if (sorted.empty() || low > high || low / KEYS_PER_ZIP5 >= ZIP5_COUNT)
+        return;
+    uint32_t lowZip = low / KEYS_PER_ZIP5;
+    uint32_t highZip = std::min(high / KEYS_PER_ZIP5, ZIP5_COUNT - 1);
+    first = offsets[lowZip];
+    last = offsets[highZip + 1];
+    auto byKey = [](const Entry& entry, uint32_t value) { return entry.key < value; };
+    if (low % KEYS_PER_ZIP5 != 0) {
+        first = std::lower_bound(sorted.begin() + first, sorted.begin() + offsets[lowZip + 1], low, byKey) - sorted.begin();
+    }
+    if (high / KEYS_PER_ZIP5 == highZip && high % KEYS_PER_ZIP5 != KEYS_PER_ZIP5 - 1) {
+        last = std::lower_bound(sorted.begin() + offsets[highZip], sorted.begin() + last, high + 1, byKey) - sorted.begin();
+    }
+    last = std::max(first, last);
+}
+
+// Number of rows with a key between low and high
+size_t ZipIndex::countBetween(uint32_t low, uint32_t high) const {
+    size_t first, last;
+    bounds(low, high, first, last);
+    return last - first;
+}
+
+// Keep selected only the rows of the bitmap with a key between low and high, only the words of the
+// matching rows are looked at besides the ones cleared whole
+void ZipIndex::andInto(uint32_t low, uint32_t high, RowBitmap& rows) const {
+    std::vector<RowId> matching;
+    forEachBetween(low, high, [&matching](RowId row) { matching.push_back(row); });
+    std::sort(matching.begin(), matching.end());
+    rows.keepOnly(matching);
+}
+
+// Bytes held by the index
+size_t ZipIndex::memoryBytes() const {
+    return (sorted.capacity() + pending.capacity()) * sizeof(Entry) + offsets.capacity() * sizeof(uint32_t);
+}
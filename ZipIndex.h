@@ -0,0 +1,60 @@
+#ifndef US_TRAFFIC_INCIDENTS_ZIPINDEX_H
+#define US_TRAFFIC_INCIDENTS_ZIPINDEX_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "RowId.h"
+#include "RowBitmap.h"
+
+// Secondary index on the numeric form of the zipcodes. A zipcode becomes a key, the 5 digits times
+// 10001 plus 1 + the 4 extra digits of a ZIP+4 (plus 0 for a plain 5-digit zipcode), so all the
+// ZIP+4 of a zipcode follow it and every digit prefix covers one contiguous range of keys. The rows
+// are sorted by key and a radix directory gives where each 5-digit zipcode starts, so a 3-digit
+// sectional center, a 5-digit zipcode or a ZIP+4 is found without a search over the rows and costs
+// time proportional to its rows. Appends wait in a pending list until it is worth a merge, and a
+// lookup merges whatever is pending first, so every answer comes from the sorted rows. Lookups run
+// under the shared lock of the engine and appends under its exclusive one; the merge a lookup does
+// is serialized by a lock of its own
+class ZipIndex {
+public:
+    static constexpr uint32_t NO_KEY = UINT32_MAX;
+    static constexpr uint32_t ZIP5_COUNT = 100000;
+    static constexpr uint32_t KEYS_PER_ZIP5 = 10001;
+
+    static uint32_t key(const std::string& zipcode);
+    static bool range(const std::string& zipcode, uint32_t& low, uint32_t& high);
+
+    void add(uint32_t key, RowId row);
+    size_t size() const;
+    size_t countBetween(uint32_t low, uint32_t high) const;
+    void andInto(uint32_t low, uint32_t high, RowBitmap& rows) const;
+    size_t memoryBytes() const;
+
+    // Call visit(row) for every row with a key between low and high, both included, in key order
+    template <typename Visit>
+    void forEachBetween(uint32_t low, uint32_t high, Visit visit) const {
+        size_t first, last;
+        bounds(low, high, first, last);
+        for (size_t i = first; i < last; ++i) {
+            visit(sorted[i].row);
+        }
+    }
+
+private:
+    struct Entry {
+        uint32_t key;
+        RowId row;
+    };
+
+    mutable std::vector<Entry> sorted;
+    mutable std::vector<Entry> pending;
+    mutable std::vector<uint32_t> offsets; // ZIP5_COUNT + 1 starts in sorted, by 5-digit zipcode
+    mutable std::mutex mergeLock;
+
+    void bounds(uint32_t low, uint32_t high, size_t& first, size_t& last) const;
+    void merge() const;
+};
+
+#endif //US_TRAFFIC_INCIDENTS_ZIPINDEX_H
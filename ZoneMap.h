@@ -0,0 +1,71 @@
+#ifndef US_TRAFFIC_INCIDENTS_ZONEMAP_H
+#define US_TRAFFIC_INCIDENTS_ZONEMAP_H
+
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include "ZipIndex.h"
+
+// Bloom filter over the dictionary codes a zone holds, two bits per code. mayContain() is never
+// false for a code that was added
+template <size_t BITS>
+class CodeFilter {
+public:
+    void add(uint32_t code) {
+        uint64_t hash = mix(code);
+        bits.set(hash % BITS);
+        bits.set((hash >> 32) % BITS);
+    }
+
+    bool mayContain(uint32_t code) const {
+        uint64_t hash = mix(code);
+        return bits.test(hash % BITS) && bits.test((hash >> 32) % BITS);
+    }
+
+private:
+    std::bitset<BITS> bits;
+
+    static uint64_t mix(uint32_t code) {
+        uint64_t hash = (code + 1) * 0x9E3779B97F4A7C15ULL;
+        return hash ^ (hash >> 29);
+    }
+};
+
+// Summary of a block of ROWS consecutive rows of the store: the range of the severities, the
+// distances and the numeric zipcodes, and filters of the states, cities and zipcodes the rows
+// hold. A scan skips a zone whose summary rules out one of its predicates. The zones line up with
+// the morsels of the column scans, 256 bitmap words
+struct ZoneMap {
+    static constexpr size_t ROWS = 16384;
+
+    uint8_t minSeverity = UINT8_MAX;
+    uint8_t maxSeverity = 0;
+    double minDistance = std::numeric_limits<double>::infinity();
+    double maxDistance = -std::numeric_limits<double>::infinity();
+    uint32_t minZipKey = UINT32_MAX; // rows without a numeric zipcode are left out
+    uint32_t maxZipKey = 0;
+    CodeFilter<512> states;
+    CodeFilter<8192> cities;
+    CodeFilter<8192> zipcodes;
+
+    void add(uint8_t severity, double distance, uint16_t state, uint32_t city, uint32_t zipcode, uint32_t zipKey) {
+        minSeverity = std::min(minSeverity, severity);
+        maxSeverity = std::max(maxSeverity, severity);
+        //a NaN distance would fail every range, it does not widen the zone
+        if (distance == distance) {
+            minDistance = std::min(minDistance, distance);
+            maxDistance = std::max(maxDistance, distance);
+        }
+        if (zipKey != ZipIndex::NO_KEY) {
+            minZipKey = std::min(minZipKey, zipKey);
+            maxZipKey = std::max(maxZipKey, zipKey);
+        }
+        states.add(state);
+        cities.add(city);
+        zipcodes.add(zipcode);
+    }
+};
+
+#endif //US_TRAFFIC_INCIDENTS_ZONEMAP_H
@@ -1,15 +1,41 @@
 #include "RedBlackTree.h"
+#include "BPlusTree.h"
 #include "Hash_table.h"
+#include "QueryEngine.h"
+#include "BatchRunner.h"
+#include "QueryServer.h"
+#include "BackgroundLoader.h"
+#include "OutputWriter.h"
+#include "Exporter.h"
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <chrono>
 #include <algorithm>
+#include <thread>
+#include <shared_mutex>
 
 bool isAlphanumeric(const std::string& str) {
     return all_of(str.begin(), str.end(), ::isalnum);
 }
 
+// Utility function to check a city name, which may have spaces and punctuation, and a trailing * for a prefix
+bool isCityName(const std::string& str) {
+    return !str.empty() && all_of(str.begin(), str.end(), [](unsigned char c) {
+        return ::isalnum(c) || c == ' ' || c == '-' || c == '.' || c == '\'' || c == '*';
+    });
+}
+
+// Utility function to check a zipcode, alphanumeric except for the dash of a ZIP+4
+bool isZipcode(const std::string& str) {
+    return all_of(str.begin(), str.end(), [](unsigned char c) { return ::isalnum(c) || c == '-'; });
+}
+
+// Utility function to check a whole number made of digits only
+bool isNumber(const std::string& str) {
+    return !str.empty() && all_of(str.begin(), str.end(), ::isdigit);
+}
+
 // Utility function to split a string by a delimiter
 std::vector<std::string> split(const std::string& str, char delimiter) {
     std::vector<std::string> tokens;
@@ -22,99 +48,40 @@ std::vector<std::string> split(const std::string& str, char delimiter) {
 }
 
 
-void readCSVTree(const std::string& filename, RedBlackTree& rbTree) {
-    std::ifstream file(filename);
-
-    if (!file.is_open()) {
-        std::cout << "Could not open the file!" << std::endl;
+// Autocomplete a city that matched nothing: the cities starting with the text, most accidents first.
+// cityRows holds the rows of each city code still in the structure
+void suggestCities(const RecordStore& store, const std::vector<uint32_t>& cityRows, const std::string& city) {
+    std::vector<uint32_t> codes = store.cityNames().complete(city, 5, cityRows);
+    if (codes.empty())
         return;
+    std::cout << "Cities starting with " << city << ":";
+    for (size_t i = 0; i < codes.size(); ++i) {
+        std::cout << (i == 0 ? " " : ", ") << store.cities().value(codes[i]) << " (" << cityRows[codes[i]] << ")";
     }
-
-    std::string line;
-    bool isHeader = true;
-    int lineNumber = 0;
-
-    while (std::getline(file, line)) {
-        lineNumber++;
-        if (isHeader) {
-            isHeader = false; // Skip the header
-            continue;
-        }
-
-        auto tokens = split(line, ',');
-
-        // Check for empty or improperly formatted lines
-        if (tokens.size() != 6) {
-            std::cerr << "Unexpected format at line " << lineNumber << ": " << line << std::endl;
-            continue;
-        }
-
-        // Ensure essential fields are not empty
-        if (tokens[0].empty() || tokens[1].empty() || tokens[2].empty() || tokens[3].empty() || tokens[4].empty() || tokens[5].empty()) {
-            std::cerr << "Skipping line " << lineNumber << " due to empty fields: " << line << std::endl;
-            continue;
-        }
-
-        try {
-            std::string id = tokens[0]; // ID is a string
-            int severity = std::stoi(tokens[1]);
-            double distance = std::stod(tokens[2]);
-            std::string city = tokens[3];
-            std::string state = tokens[4];
-            std::string zipcode = tokens[5];
-
-            // Insert data into the Red-Black Tree
-            rbTree.insert(id, severity, distance, city, state, zipcode);
-        } catch (const std::invalid_argument& e) {
-            std::cerr << "Invalid data encountered at line " << lineNumber << ": " << line << "\nError: " << e.what() << std::endl;
-        } catch (const std::out_of_range& e) {
-            std::cerr << "Data out of range at line " << lineNumber << ": " << line << "\nError: " << e.what() << std::endl;
-        }
-    }
-
-    file.close();
+    std::cout << std::endl;
 }
 
-void readCSVHashTable(const std::string& filename, HashTable& hashTable) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Could not open the file: " << filename << std::endl;
-        return;
-    }
-
-    string line;
-    bool isHeader = true;
-    while (std::getline(file, line)) {
-        if (isHeader) {
-            isHeader = false;
-            continue;
-        }
-
-        auto tokens = split(line, ',');
+// Row behind a result of an ordered index, the Red Black Tree returns nodes and the B+ Tree returns rows
+RowId rowOf(const Node* node) {
+    return node == nullptr ? NO_ROW : node->row;
+}
 
-        if (tokens.size() >= 6) {
-            try {
-                TrafficAccident accident(tokens[0], std::stoi(tokens[1]), std::stod(tokens[2]), tokens[3], tokens[4], tokens[5]);
-                hashTable.insert(accident);
-            } catch (const std::invalid_argument& e) {
-                std::cerr << "Invalid argument: " << e.what() << " in line: " << line << endl;
-            } catch (const std::out_of_range& e) {
-                std::cerr << "Out of range: " << e.what() << " in line: " << line << endl;
-            }
-        }
-    }
-    file.close();
+RowId rowOf(RowId row) {
+    return row;
 }
 
-void menuRedBlackTree(RedBlackTree& rbTree) {
+// Menu for the ordered indexes, the same menu drives the Red Black Tree and the B+ Tree
+template <typename OrderedIndex>
+void menuOrderedIndex(OrderedIndex& tree, const RecordStore& store, const std::string& name) {
+    OutputWriter writer(std::cout); // the rows are buffered and written at the end of each result
     int choice = 0, searchType;
     std::string id, city, state, zipcode;
     int severity;
     double distance;
-    std::vector<Node*> filteredNodes;
+    decltype(tree.getAllNodes()) filteredNodes;
 
     while (choice != 6) {
-        std::cout << "\nRed Black Tree Menu:\n";
+        std::cout << "\n" << name << " Menu:\n";
         std::cout << "1. Insert\n";
         std::cout << "2. Search\n";
         std::cout << "3. Remove by ID\n";
@@ -132,14 +99,14 @@ void menuRedBlackTree(RedBlackTree& rbTree) {
             std::cout << "Enter Distance: ";
             std::cin >> distance;
             std::cout << "Enter City: ";
-            std::cin >> city;
+            std::getline(std::cin >> std::ws, city);
             std::cout << "Enter State: ";
             std::cin >> state;
             std::cout << "Enter Zipcode: ";
             std::cin >> zipcode;
 
             auto start = std::chrono::system_clock::now();
-            rbTree.insert(id, severity, distance, city, state, zipcode);
+            tree.insert(id, severity, distance, city, state, zipcode);
             auto end = std::chrono::system_clock::now();
             std::chrono::duration<double> elapsed_seconds = end - start;
             std::cout << "\nElapsed Time: " << elapsed_seconds.count() << "s" << std::endl;
@@ -148,44 +115,85 @@ void menuRedBlackTree(RedBlackTree& rbTree) {
             std::cout << "Do you want to search by:\n";
             std::cout << "1. ID\n";
             std::cout << "2. Severity\n";
-            std::cout << "3. City\n";
+            std::cout << "3. City (any case, San* for every city starting with San)\n";
             std::cout << "4. State\n";
-            std::cout << "5. Zipcode\n";
+            std::cout << "5. Zipcode (5 digits, ZIP+4 or a prefix such as 708)\n";
+            std::cout << "6. ID range\n";
+            std::cout << "7. ID prefix\n";
+            std::cout << "8. Many IDs (separated by spaces, looked up together)\n";
             std::cout << "Enter your choice: ";
             std::cin >> searchType;
 
             auto start = std::chrono::system_clock::now();
-            std::vector<Node*> results;
+            decltype(tree.getAllNodes()) results;
             if (searchType == 1) {
                 std::cout << "Enter ID: ";
                 std::cin >> id;
-                Node* result = rbTree.search(id);
+                RowId result = rowOf(tree.search(id));
                 auto end = std::chrono::system_clock::now();
                 std::chrono::duration<double> elapsed_seconds = end - start;
-                if (result) {
-                    std::cout << "ID: " << result->ID << ", Severity: " << result->severity << ", Distance: " << result->distance
-                              << ", City: " << result->city << ", State: " << result->state << ", Zipcode: " << result->zipcode << std::endl;
+                if (result != NO_ROW) {
+                    writer.row(store, result);
+                    writer.flush();
                 } else {
                     std::cout << "ID " << id << " not found in the tree." << std::endl;
                 }
                 std::cout << "\nElapsed Time: " << elapsed_seconds.count() << "s" << std::endl;
+            } else if (searchType == 8) {
+                std::string line;
+                std::cout << "Enter IDs: ";
+                std::getline(std::cin >> std::ws, line);
+                std::vector<std::string> ids = split(line, ' ');
+                ids.erase(std::remove(ids.begin(), ids.end(), ""), ids.end());
+                start = std::chrono::system_clock::now();
+                tree.multiGet(ids, results);
+                auto end = std::chrono::system_clock::now();
+                std::chrono::duration<double> elapsed_seconds = end - start;
+                for (size_t i = 0; i < ids.size(); ++i) {
+                    if (rowOf(results[i]) != NO_ROW) {
+                        writer.row(store, rowOf(results[i]));
+                    } else {
+                        writer.text("ID " + ids[i] + " not found in the tree.\n");
+                    }
+                }
+                writer.flush();
+                std::cout << "\nElapsed Time: " << elapsed_seconds.count() << "s" << std::endl;
             } else {
                 if (searchType == 2) {
                     std::cout << "Enter Severity: ";
                     std::cin >> severity;
-                    results = rbTree.searchBySeverity(severity);
+                    results = tree.searchBySeverity(severity);
                 } else if (searchType == 3) {
                     std::cout << "Enter City: ";
-                    std::cin >> city;
-                    results = rbTree.searchByCity(city);
+                    std::getline(std::cin >> std::ws, city);
+                    results = tree.searchByCity(city);
+                    if (results.empty()) {
+                        //the tree keeps no counts per city, they are taken from its nodes like the search did
+                        std::vector<uint32_t> cityRows(store.cities().size());
+                        for (const auto& node : tree.getAllNodes()) {
+                            ++cityRows[store.cityCode(rowOf(node))];
+                        }
+                        suggestCities(store, cityRows, city);
+                    }
                 } else if (searchType == 4) {
                     std::cout << "Enter State: ";
                     std::cin >> state;
-                    results = rbTree.searchByState(state);
+                    results = tree.searchByState(state);
                 } else if (searchType == 5) {
                     std::cout << "Enter Zipcode: ";
                     std::cin >> zipcode;
-                    results = rbTree.searchByZipcode(zipcode);
+                    results = tree.searchByZipcode(zipcode);
+                } else if (searchType == 6) {
+                    std::string lastId;
+                    std::cout << "Enter first ID: ";
+                    std::cin >> id;
+                    std::cout << "Enter last ID: ";
+                    std::cin >> lastId;
+                    results = tree.rangeScan(id, lastId);
+                } else if (searchType == 7) {
+                    std::cout << "Enter ID prefix: ";
+                    std::cin >> id;
+                    results = tree.prefixScan(id);
                 } else {
                     std::cout << "Invalid search type, please try again." << std::endl;
                     continue;
@@ -195,9 +203,9 @@ void menuRedBlackTree(RedBlackTree& rbTree) {
 
                 if (!results.empty()) {
                     for (const auto& node : results) {
-                        std::cout << "ID: " << node->ID << ", Severity: " << node->severity << ", Distance: " << node->distance
-                                  << ", City: " << node->city << ", State: " << node->state << ", Zipcode: " << node->zipcode << std::endl;
+                        writer.row(store, rowOf(node));
                     }
+                    writer.flush();
                 } else {
                     std::cout << "No results found." << std::endl;
                 }
@@ -208,31 +216,32 @@ void menuRedBlackTree(RedBlackTree& rbTree) {
             std::cout << "Enter ID: ";
             std::cin >> id;
             auto start = std::chrono::system_clock::now();
-            rbTree.remove(id);
+            tree.remove(id);
             auto end = std::chrono::system_clock::now();
             std::chrono::duration<double> elapsed_seconds = end - start;
             std::cout << "\nElapsed Time: " << elapsed_seconds.count() << "s" << std::endl;
 
         } else if (choice == 4) {
             auto start = std::chrono::system_clock::now();
-            rbTree.inorder();
+            tree.inorder(writer);
+            writer.flush();
             auto end = std::chrono::system_clock::now();
             std::chrono::duration<double> elapsed_seconds = end - start;
             std::cout << "\nElapsed Time: " << elapsed_seconds.count() << "s" << std::endl;
 
         } else if (choice == 5) {
-            filteredNodes = rbTree.getAllNodes(); // Start with all nodes
+            AccidentFilter filter; // Collect the predicates, the tree is scanned once at the end
             char continueFiltering = 'y';
             while (continueFiltering == 'y' || continueFiltering == 'Y') {
                 std::cout << "\nChoose a filter:\n";
                 std::cout << "1. Severity\n";
-                std::cout << "2. City\n";
+                std::cout << "2. City (any case, San* for every city starting with San)\n";
                 std::cout << "3. State\n";
-                std::cout << "4. Zipcode\n";
+                std::cout << "4. Zipcode (5 digits, ZIP+4 or a prefix such as 708)\n";
+                std::cout << "5. Distance range\n";
                 std::cout << "Enter your choice: ";
                 std::cin >> searchType;
 
-                auto start = std::chrono::system_clock::now();
                 if (searchType == 1) {
                     std::cout << "Enter Severity: ";
                     if (!(std::cin >> severity)) {
@@ -241,17 +250,17 @@ void menuRedBlackTree(RedBlackTree& rbTree) {
                         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                         continue;
                     }
-                    filteredNodes = rbTree.filterBySeverity(filteredNodes, severity);
+                    filter.requireSeverity(severity);
                 } else if (searchType == 2) {
                     std::cout << "Enter City: ";
-                    std::cin >> city;
-                    if (!isAlphanumeric(city)) {
+                    std::getline(std::cin >> std::ws, city);
+                    if (!isCityName(city)) {
                         std::cout << "Input not valid" << std::endl;
                         std::cin.clear();
                         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                         continue;
                     }
-                    filteredNodes = rbTree.filterByCity(filteredNodes, city);
+                    filter.requireCity(city);
                 } else if (searchType == 3) {
                     std::cout << "Enter State: ";
                     std::cin >> state;
@@ -261,39 +270,60 @@ void menuRedBlackTree(RedBlackTree& rbTree) {
                         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                         continue;
                     }
-                    filteredNodes = rbTree.filterByState(filteredNodes, state);
+                    filter.requireState(state);
                 } else if (searchType == 4) {
                     std::cout << "Enter Zipcode: ";
                     std::cin >> zipcode;
-                    if (!isAlphanumeric(zipcode)) {
+                    if (!isZipcode(zipcode)) {
                         std::cout << "Input not valid" << std::endl;
                         std::cin.clear();
                         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                         continue;
                     }
-                    filteredNodes = rbTree.filterByZipcode(filteredNodes, zipcode);
+                    filter.requireZipcode(zipcode);
+                } else if (searchType == 5) {
+                    double maxDistance;
+                    std::cout << "Enter minimum Distance: ";
+                    if (!(std::cin >> distance)) {
+                        std::cout << "Input not valid" << std::endl;
+                        std::cin.clear();
+                        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                        continue;
+                    }
+                    std::cout << "Enter maximum Distance: ";
+                    if (!(std::cin >> maxDistance)) {
+                        std::cout << "Input not valid" << std::endl;
+                        std::cin.clear();
+                        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                        continue;
+                    }
+                    filter.requireDistance(distance, maxDistance);
                 } else {
                     std::cout << "Invalid search type, please try again." << std::endl;
                     continue;
                 }
-                auto end = std::chrono::system_clock::now();
-                std::chrono::duration<double> elapsed_seconds = end - start;
-                std::cout << "\nElapsed Time: " << elapsed_seconds.count() << "s" << std::endl;
 
                 std::cout << "Do you want to apply another filter? (y/n): ";
                 std::cin >> continueFiltering;
             }
 
+            auto start = std::chrono::system_clock::now();
+            filter.compile(store);
+            filteredNodes = tree.find(filter);
+            auto end = std::chrono::system_clock::now();
+            std::chrono::duration<double> elapsed_seconds = end - start;
+            std::cout << "\nElapsed Time: " << elapsed_seconds.count() << "s" << std::endl;
+
             if (!filteredNodes.empty()) {
                 for (const auto& node : filteredNodes) {
-                    std::cout << "ID: " << node->ID << ", Severity: " << node->severity << ", Distance: " << node->distance
-                              << ", City: " << node->city << ", State: " << node->state << ", Zipcode: " << node->zipcode << std::endl;
+                    writer.row(store, rowOf(node));
                 }
+                writer.flush();
             } else {
                 std::cout << "No results found." << std::endl;
             }
         } else if (choice == 6) {
-            std::cout << "Exiting Red Black Tree Menu." << std::endl;
+            std::cout << "Exiting " << name << " Menu." << std::endl;
             break;
         } else {
             std::cout << "Invalid choice, please try again." << std::endl;
@@ -301,7 +331,8 @@ void menuRedBlackTree(RedBlackTree& rbTree) {
     }
 }
 
-void menuHashTable(HashTable& hashTable) {
+void menuHashTable(HashTable& hashTable, const RecordStore& store) {
+    OutputWriter writer(std::cout); // the rows are buffered and written at the end of each result
     int choice = 0, searchType;
     string id, city, state, zipcode;
     int severity;
@@ -326,7 +357,7 @@ void menuHashTable(HashTable& hashTable) {
             cout << "Enter Distance: ";
             cin >> distance;
             cout << "Enter City: ";
-            cin >> city;
+            std::getline(std::cin >> std::ws, city);
             cout << "Enter State: ";
             cin >> state;
             cout << "Enter Zipcode: ";
@@ -343,19 +374,42 @@ void menuHashTable(HashTable& hashTable) {
             cout << "Do you want to search by:\n";
             cout << "1. ID\n";
             cout << "2. Severity\n";
-            cout << "3. City\n";
+            cout << "3. City (any case, San* for every city starting with San)\n";
             cout << "4. State\n";
-            cout << "5. Zipcode\n";
+            cout << "5. Zipcode (5 digits, ZIP+4 or a prefix such as 708)\n";
+            cout << "6. Many IDs (separated by spaces, looked up together)\n";
             cout << "Enter your choice: ";
             cin >> searchType;
 
-            if (searchType == 1) {
+            if (searchType == 6) {
+                string line;
+                cout << "Enter IDs: ";
+                std::getline(std::cin >> std::ws, line);
+                vector<string> ids = split(line, ' ');
+                ids.erase(remove(ids.begin(), ids.end(), ""), ids.end());
+
+                chrono::time_point<chrono::system_clock> start, end;
+                start = chrono::system_clock::now();
+                vector<RowId> rows;
+                hashTable.multiGet(ids, rows);
+                end = chrono::system_clock::now();
+                chrono::duration<double> elapsed_seconds = end - start;
+                for (size_t i = 0; i < ids.size(); ++i) {
+                    if (rows[i] != NO_ROW) {
+                        writer.row(store, rows[i]);
+                    } else {
+                        writer.text("ID " + ids[i] + " not found in the hash table.\n");
+                    }
+                }
+                writer.flush();
+                cout << "\nElapsed Time: " << elapsed_seconds.count() << "s" << endl;
+            } else if (searchType == 1) {
                 cout << "Enter ID: ";
                 cin >> id;
-                TrafficAccident* accident = hashTable.searchByID(id);
-                if (accident) {
-                    std::cout << "ID: " << accident->ID << ", Severity: " << accident->severity << ", Distance: " << accident->distance
-                              << ", City: " << accident->city << ", State: " << accident->state << ", Zipcode: " << accident->zipcode << std::endl;
+                RowId accident = hashTable.searchByID(id);
+                if (accident != NO_ROW) {
+                    writer.row(store, accident);
+                    writer.flush();
                 } else {
                     std::cout << "ID " << id << " not found in the hash table." << std::endl;
                 }
@@ -368,19 +422,24 @@ void menuHashTable(HashTable& hashTable) {
                 HashTable results = hashTable.searchBySeverity(severity);
                 end = chrono::system_clock::now();
                 chrono::duration<double> elapsed_seconds = end - start;
-                results.display();
+                results.display(writer);
+                writer.flush();
                 cout << "\nElapsed Time: " << elapsed_seconds.count() << "s" << endl;
 
             } else if (searchType == 3) {
                 cout << "Enter City: ";
-                cin >> city;
+                std::getline(std::cin >> std::ws, city);
 
                 chrono::time_point<chrono::system_clock> start, end;
                 start = chrono::system_clock::now();
                 HashTable results = hashTable.searchByCity(city);
                 end = chrono::system_clock::now();
                 chrono::duration<double> elapsed_seconds = end - start;
-                results.display();
+                results.display(writer);
+                writer.flush();
+                if (results.isEmpty()) {
+                    suggestCities(store, hashTable.getCityRows(), city);
+                }
                 cout << "\nElapsed Time: " << elapsed_seconds.count() << "s" << endl;
 
             } else if (searchType == 4) {
@@ -394,7 +453,8 @@ void menuHashTable(HashTable& hashTable) {
                 HashTable results = hashTable.searchByState(state);
                 end = chrono::system_clock::now();
                 chrono::duration<double> elapsed_seconds = end - start;
-                results.display();
+                results.display(writer);
+                writer.flush();
                 cout << "\nElapsed Time: " << elapsed_seconds.count() << "s" << endl;
 
             } else if (searchType == 5) {
@@ -405,7 +465,8 @@ void menuHashTable(HashTable& hashTable) {
                 HashTable results = hashTable.searchByZipcode(zipcode);
                 end = chrono::system_clock::now();
                 chrono::duration<double> elapsed_seconds = end - start;
-                results.display();
+                results.display(writer);
+                writer.flush();
                 cout << "\nElapsed Time: " << elapsed_seconds.count() << "s" << endl;
             } else {
                 cout << "Invalid search type, please try again." << endl;
@@ -424,19 +485,21 @@ void menuHashTable(HashTable& hashTable) {
         } else if (choice == 4) {
             chrono::time_point<chrono::system_clock> start, end;
             start = chrono::system_clock::now();
-            hashTable.display();
+            hashTable.display(writer);
+            writer.flush();
             end = chrono::system_clock::now();
             chrono::duration<double> elapsed_seconds = end - start;
             cout << "\nElapsed Time: " << elapsed_seconds.count() << "s" << endl;
         } else if (choice == 5) {
-            HashTable filteredTable = hashTable;
+            AccidentFilter filter; // Collect the predicates, the table is scanned once at the end
             char continueFiltering = 'y';
             while (continueFiltering == 'y' || continueFiltering == 'Y') {
                 std::cout <<"\nChoose a filter:\n";
                 cout << "1. Severity\n";
-                cout << "2. City\n";
+                cout << "2. City (any case, San* for every city starting with San)\n";
                 cout << "3. State\n";
-                cout << "4. Zipcode\n";
+                cout << "4. Zipcode (5 digits, ZIP+4 or a prefix such as 708)\n";
+                cout << "5. Distance range\n";
                 cout << "Enter your choice: ";
                 cin >> searchType;
 
@@ -448,17 +511,17 @@ void menuHashTable(HashTable& hashTable) {
                         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                         continue;
                     }
-                    filteredTable = filteredTable.searchBySeverity(severity);
+                    filter.requireSeverity(severity);
                 } else if (searchType == 2) {
                     cout << "Enter City: ";
-                    cin >> city;
-                    if (!isAlphanumeric(city)) {
+                    std::getline(std::cin >> std::ws, city);
+                    if (!isCityName(city)) {
                         std::cout << "Input not valid" << std::endl;
                         std::cin.clear();
                         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                         continue;
                     }
-                    filteredTable = filteredTable.searchByCity(city);
+                    filter.requireCity(city);
                 } else if (searchType == 3) {
                     cout << "Enter State: ";
                     cin >> state;
@@ -468,17 +531,34 @@ void menuHashTable(HashTable& hashTable) {
                         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                         continue;
                     }
-                    filteredTable = filteredTable.searchByState(state);
+                    filter.requireState(state);
                 } else if (searchType == 4) {
                     cout << "Enter Zipcode: ";
                     cin >> zipcode;
-                    if (!isAlphanumeric(zipcode)) {
+                    if (!isZipcode(zipcode)) {
                         std::cout << "Input not valid" << std::endl;
                         std::cin.clear();
                         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                         continue;
                     }
-                    filteredTable = filteredTable.searchByZipcode(zipcode);
+                    filter.requireZipcode(zipcode);
+                } else if (searchType == 5) {
+                    double maxDistance;
+                    cout << "Enter minimum Distance: ";
+                    if (!(std::cin >> distance)) {
+                        cout << "Input not valid" << endl;
+                        std::cin.clear();
+                        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                        continue;
+                    }
+                    cout << "Enter maximum Distance: ";
+                    if (!(std::cin >> maxDistance)) {
+                        cout << "Input not valid" << endl;
+                        std::cin.clear();
+                        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                        continue;
+                    }
+                    filter.requireDistance(distance, maxDistance);
                 } else {
                     cout << "Invalid search type, please try again." << endl;
                 }
@@ -487,7 +567,15 @@ void menuHashTable(HashTable& hashTable) {
                 cin >> continueFiltering;
             }
 
-            filteredTable.display();
+            chrono::time_point<chrono::system_clock> start, end;
+            start = chrono::system_clock::now();
+            filter.compile(store);
+            HashTable filteredTable = hashTable.filter(filter);
+            end = chrono::system_clock::now();
+            chrono::duration<double> elapsed_seconds = end - start;
+            filteredTable.display(writer);
+            writer.flush();
+            cout << "\nElapsed Time: " << elapsed_seconds.count() << "s" << endl;
 
         } else if (choice == 6) {
             cout <<"Exiting Hash Table Menu." << endl;
@@ -498,29 +586,280 @@ void menuHashTable(HashTable& hashTable) {
     }
 }
 
-int main() {
-    HashTable hashTable;
-    RedBlackTree rbTree;
+// Menu for the query layer, the user types the predicates and the planner picks the structure
+void menuQuery(QueryEngine& engine, const BackgroundLoader& loader) {
+    const RecordStore& store = engine.getStore();
+    OutputWriter::Format format = OutputWriter::TEXT;
+    std::string line;
+
+    std::cout << "\nQuery Menu:\n";
+    std::cout << "Enter predicates separated by spaces, for example:\n";
+    std::cout << "  severity=4 state=TX distance>=2\n";
+    std::cout << "  id>=A-1000 id<=A-1100 city=\"San Antonio\"\n";
+    std::cout << "  severity=4 group=state   (count and distance totals per state)\n";
+    std::cout << "  state=TX top=20          (the 20 longest accidents in TX, with group= the 20 largest groups)\n";
+    std::cout << "  distance>=20             (accidents longer than 20 miles, from the distance index)\n";
+    std::cout << "  zipcode=708              (every zipcode starting with 708, ZIP+4 included)\n";
+    std::cout << "  city=\"san ant*\" top=5    (cities are matched in any case, * ends a prefix)\n";
+    std::cout << "Start with explain to see the chosen plan, or estimate to only see the estimated number of rows.\n";
+    std::cout << "Enter quantiles for the distance percentiles, cities followed by the start of a name to\n";
+    std::cout << "complete a city (cities san an), cache for the result cache statistics (cache 16 sets\n";
+    std::cout << "its budget to 16 MB), status to see how far the load has come, format text, csv, jsonl or\n";
+    std::cout << "binary to change how the rows are printed, export followed by a file ending in .csv or .col\n";
+    std::cout << "and a query to write its rows to a CSV or a columnar file, exit to leave.\n";
+
+    while (true) {
+        std::cout << "\nQuery: ";
+        if (!std::getline(std::cin >> std::ws, line) || line == "exit") {
+            std::cout << "Exiting Query Menu." << std::endl;
+            break;
+        }
+
+        if (line.compare(0, 7, "format ") == 0) {
+            if (!OutputWriter::parseFormat(line.substr(7), format)) {
+                std::cout << "Unknown format. Please enter text, csv, jsonl or binary." << std::endl;
+                continue;
+            }
+            std::cout << "Rows are printed as " << OutputWriter::formatName(format) << "." << std::endl;
+            continue;
+        }
 
-    // Read from CSV and populate the hash table and red-black tree
-    readCSVHashTable("../Database/US_Accidents_MarchCORRECTED.csv", hashTable);
-    readCSVTree("../Database/US_Accidents_MarchCORRECTED.csv", rbTree);
+        if (line == "status") {
+            loader.status().print(std::cout);
+            continue;
+        }
+
+        //the background load adds its rows between queries, never during one
+        std::shared_lock<std::shared_mutex> lock(engine.getLock());
+        bool loading = !loader.isComplete();
+
+        if (line.compare(0, 7, "export ") == 0) {
+            std::string rest = line.substr(7);
+            size_t space = rest.find(' ');
+            std::string path = rest.substr(0, space), error;
+            Query query;
+            if (!Query::parse(space == std::string::npos ? "" : rest.substr(space + 1), store, query, error)) {
+                std::cout << error << std::endl;
+                continue;
+            }
+            if (query.hasGroup || query.explain || query.estimate) {
+                std::cout << "Export takes a query without group=, explain or estimate." << std::endl;
+                continue;
+            }
+            auto start = std::chrono::steady_clock::now();
+            QueryPlan plan;
+            std::vector<RowId> rows = query.top > 0 ? engine.top(query, plan) : engine.execute(query, plan);
+            if (!Exporter::write(store, rows, path, error)) {
+                std::cout << error << std::endl;
+                continue;
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << "Exported " << rows.size() << " rows to " << path << std::endl;
+            std::cout << "\nElapsed Time: " << elapsed.count() << "s" << std::endl;
+            continue;
+        }
+
+        if (line == "quantiles") {
+            //read from the histogram of the distance index, no row is visited
+            const DistanceIndex& distances = store.sortedDistances();
+            const double fractions[] = {0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 1.0};
+            for (double fraction : fractions) {
+                std::cout << "p" << fraction * 100 << " Distance: " << distances.quantile(fraction) << std::endl;
+            }
+            continue;
+        }
+
+        if (line == "cache" || line.compare(0, 6, "cache ") == 0) {
+            ResultCache& cache = engine.getCache();
+            if (line.size() > 6) {
+                std::string megabytes = line.substr(6);
+                if (!isNumber(megabytes) || megabytes.size() > 6) {
+                    std::cout << "Invalid budget. Please enter a whole number of megabytes." << std::endl;
+                    continue;
+                }
+                cache.setBudget(std::stoul(megabytes) * 1024 * 1024);
+            }
+            ResultCache::Stats stats = cache.stats();
+            std::cout << "Hits: " << stats.hits << ", Misses: " << stats.misses << ", Hit Rate: " << stats.hitRate() * 100 << "%" << std::endl;
+            std::cout << "Entries: " << stats.entries << ", Memory: " << stats.bytes << " of " << stats.budget << " bytes"
+                      << ", Evictions: " << stats.evictions << ", Invalidations: " << stats.invalidations << std::endl;
+            continue;
+        }
+
+        if (line.compare(0, 7, "cities ") == 0) {
+            std::string start = line.substr(7);
+            std::vector<uint32_t> codes = store.cityNames().complete(start, 10, engine.cityRows());
+            for (uint32_t code : codes) {
+                std::cout << "City: " << store.cities().value(code) << ", Count: " << engine.cityRows()[code] << std::endl;
+            }
+            if (codes.empty()) {
+                std::cout << "No city starts with " << start << "." << std::endl;
+            }
+            continue;
+        }
+
+        Query query;
+        std::string error;
+        if (!Query::parse(line, store, query, error)) {
+            std::cout << error << std::endl;
+            continue;
+        }
+
+        QueryPlan plan;
+        if (query.estimate) {
+            plan = engine.plan(query);
+            std::cout << "Estimated rows: " << plan.estimatedRows << " (" << QueryPlan::pathName(plan.path) << ")" << std::endl;
+            continue;
+        }
+        if (query.hasGroup) {
+            std::vector<Group> groups = engine.aggregate(query, plan);
+            for (const auto& group : groups) {
+                GroupBy::print(store, query.groupBy, group, std::cout);
+            }
+            if (groups.empty()) {
+                std::cout << "No results found." << std::endl;
+            }
+            if (query.explain) {
+                plan.print(std::cout, query);
+                std::cout << "  grouped by " << GroupBy::fieldName(query.groupBy) << " into " << groups.size() << " groups";
+                if (query.top > 0) {
+                    std::cout << ", the " << query.top << " largest kept with a bounded heap";
+                }
+                std::cout << std::endl;
+            }
+            std::cout << "\nElapsed Time: " << plan.elapsedSeconds << "s" << std::endl;
+            if (loading) {
+                std::cout << "Answered from the " << store.size() << " rows loaded so far." << std::endl;
+            }
+            continue;
+        }
+
+        std::vector<RowId> rows = query.top > 0 ? engine.top(query, plan) : engine.execute(query, plan);
+        if (!rows.empty()) {
+            OutputWriter writer(std::cout, format);
+            writer.header();
+            for (RowId row : rows) {
+                writer.row(store, row);
+            }
+            writer.flush();
+        } else {
+            std::cout << "No results found." << std::endl;
+        }
+        if (query.explain) {
+            plan.print(std::cout, query);
+            if (query.top > 0) {
+                std::cout << "  top " << query.top << " by distance kept with a bounded heap" << std::endl;
+            }
+        }
+        std::cout << "\nElapsed Time: " << plan.elapsedSeconds << "s" << std::endl;
+        if (loading) {
+            std::cout << "Answered from the " << store.size() << " rows loaded so far." << std::endl;
+        }
+    }
+}
+
+// Wait for the background load, showing how far it has come
+void waitForLoad(const BackgroundLoader& loader) {
+    if (loader.isComplete())
+        return;
+    std::cout << "Waiting for the data to load. ";
+    loader.status().print(std::cout);
+    loader.wait();
+    loader.status().print(std::cout);
+}
+
+// Batch mode: run the commands of a file, or of the standard input for -, with no menu
+int runBatch(QueryEngine& engine, const BackgroundLoader& loader, const std::string& path) {
+    std::ios::sync_with_stdio(false);
+    std::ifstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file.is_open()) {
+            std::cout << "Error: Could not open the batch file " << path << std::endl;
+            return 1;
+        }
+    }
+    BatchRunner runner(engine, &loader);
+    BatchSummary summary = runner.run(path == "-" ? std::cin : file, std::cout);
+    summary.print(std::cout);
+    return summary.errors == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    std::string batchPath, socketPath;
+    unsigned workers = std::thread::hardware_concurrency();
+    bool validArguments = true;
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (i + 1 == argc) {
+            validArguments = false;
+        } else if (option == "--batch") {
+            batchPath = argv[++i];
+        } else if (option == "--serve") {
+            socketPath = argv[++i];
+        } else if (option == "--workers" && isNumber(argv[i + 1]) && std::string(argv[i + 1]).size() < 5) {
+            workers = std::stoul(argv[++i]);
+        } else {
+            validArguments = false;
+        }
+    }
+    if (!validArguments || (!batchPath.empty() && !socketPath.empty()) || workers == 0) {
+        std::cout << "Usage: " << argv[0] << " [--batch <file with one command per line, or - for the standard input>]\n"
+                  << "       " << argv[0] << " [--serve <unix socket path> [--workers <threads>]]" << std::endl;
+        return 1;
+    }
+    if (!socketPath.empty() && !QueryServer::isSupported()) {
+        std::cout << "Error: The query server needs Linux (epoll)" << std::endl;
+        return 1;
+    }
+
+    RecordStore store;
+    HashTable hashTable(store);
+    RedBlackTree rbTree(store);
+    BPlusTree bPlusTree(store);
+    QueryEngine engine(store, hashTable, rbTree, bPlusTree);
+
+    // Read the CSV into the store in the background: the hash table indexes the rows as they come,
+    // the B+ Tree and the Red Black Tree are built over them afterwards
+    BackgroundLoader loader(engine, store, hashTable, rbTree, bPlusTree);
+    loader.start("../Database/US_Accidents_MarchCORRECTED.csv", !socketPath.empty());
+
+    if (!batchPath.empty()) {
+        //the results of a script should not depend on how far the load has come
+        loader.wait();
+        return runBatch(engine, loader, batchPath);
+    }
+    if (!socketPath.empty()) {
+        QueryServer server(engine, loader, socketPath, workers);
+        return server.run() ? 0 : 1;
+    }
 
     int choice;
 
     cout << "Welcome to the US Traffic accidents (2016-2023) Database" << endl;
-    cout << "Two data structures are used to store a database containing 100,000 accidents,(Red-Black Tree, Hash Table)." << endl;
+    cout << "Three data structures are used to store a database containing 100,000 accidents,(Red-Black Tree, Hash Table, B+ Tree)." << endl;
 
     cout << "Which data structure do you want to use?" << endl;
     cout << "1. Red Black Tree" << endl;
     cout << "2. Hash Table" << endl;
+    cout << "3. B+ Tree" << endl;
+    cout << "4. Query (the structure is picked for each query, available while the data loads)" << endl;
+    loader.status().print(cout);
     cout << "Enter your choice: " ;
     cin >> choice;
 
+    //the menus of the structures use them directly, they open once the load is done
+    if (choice >= 1 && choice <= 3) {
+        waitForLoad(loader);
+    }
     if (choice == 1) {
-        menuRedBlackTree(rbTree);
+        menuOrderedIndex(rbTree, store, "Red Black Tree");
     } else if (choice == 2) {
-        menuHashTable(hashTable);
+        menuHashTable(hashTable, store);
+    } else if (choice == 3) {
+        menuOrderedIndex(bPlusTree, store, "B+ Tree");
+    } else if (choice == 4) {
+        menuQuery(engine, loader);
     } else {
         cout << "Invalid choice, exiting." << endl;
     }
@@ -0,0 +1,19 @@
+#ifndef US_TRAFFIC_INCIDENTS_CHECK_H
+#define US_TRAFFIC_INCIDENTS_CHECK_H
+
+#include <iostream>
+
+// Number of checks that failed, main() of a test returns non-zero when there are any
+inline int failures = 0;
+
+// Report a condition that does not hold with its file and line, the test goes on with the next check
+inline void check(bool condition, const char* text, const char* file, int line) {
+    if (!condition) {
+        std::cout << file << ":" << line << ": check failed: " << text << std::endl;
+        ++failures;
+    }
+}
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+#endif //US_TRAFFIC_INCIDENTS_CHECK_H
@@ -0,0 +1,59 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Check.h"
+#include "BackgroundLoader.h"
+
+// A CSV row with a "nan" distance, which std::stod reads, is skipped by the load, so the distance
+// index only holds numbers and its range lookups and quantiles stay right
+static void nanDistanceIsSkipped() {
+    const std::string path = "DistanceIndexTest.csv";
+    {
+        //distances 0.00 to 19.99, one row per hundredth, with a nan row in the middle
+        std::ofstream csv(path);
+        csv << "ID,Severity,Distance(mi),City,State,Zipcode\n";
+        for (int i = 0; i < 2000; ++i) {
+            std::string cents = std::to_string(100 + i % 100).substr(1);
+            csv << "A-" << 1000 + i << ",2," << i / 100 << "." << cents << ",Austin,TX,78701\n";
+            if (i == 1000) {
+                csv << "A-9999,2,nan,Austin,TX,78701\n";
+            }
+        }
+    }
+
+    RecordStore store;
+    HashTable hashTable(store);
+    RedBlackTree rbTree(store);
+    BPlusTree bPlusTree(store);
+    QueryEngine engine(store, hashTable, rbTree, bPlusTree);
+    BackgroundLoader loader(engine, store, hashTable, rbTree, bPlusTree);
+    CHECK(loader.start(path));
+    loader.wait();
+    std::remove(path.c_str());
+    CHECK(store.size() == 2000);
+    CHECK(hashTable.getSize() == 2000);
+
+    //a narrow range is answered from the distance index
+    Query query;
+    std::string error;
+    CHECK(Query::parse("distance>=5 distance<=5.05", store, query, error));
+    QueryPlan plan;
+    std::vector<RowId> rows = engine.execute(query, plan);
+    CHECK(plan.path == QueryPlan::DISTANCE_RANGE);
+    CHECK(rows.size() == 6);
+    for (RowId row : rows) {
+        CHECK(store.distance(row) >= 5 && store.distance(row) <= 5.05);
+    }
+    CHECK(store.sortedDistances().countBetween(5, 5.05) == 6);
+
+    const DistanceIndex& distances = store.sortedDistances();
+    CHECK(distances.quantile(0.0) == 0.0);
+    CHECK(distances.quantile(1.0) == 19.99);
+    CHECK(distances.quantile(0.5) >= 9.9 && distances.quantile(0.5) <= 10.1);
+}
+
+int main() {
+    nanDistanceIsSkipped();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+#include <string>
+#include <vector>
+#include "Check.h"
+#include "QueryEngine.h"
+
+// An ID range with a selective filter over most of the table is cheaper to answer with the index
+// scan than with a tree, the scan then has to drop the rows outside the range itself
+static void idRangeOnScanPath() {
+    RecordStore store;
+    HashTable hashTable(store);
+    RedBlackTree rbTree(store);
+    BPlusTree bPlusTree(store);
+    QueryEngine engine(store, hashTable, rbTree, bPlusTree);
+    std::string error;
+    //IDs A-1000 to A-1999, every tenth row has severity 4
+    for (int i = 0; i < 1000; ++i) {
+        int severity = i % 10 == 0 ? 4 : 2;
+        CHECK(engine.insert(TrafficAccident("A-" + std::to_string(1000 + i), severity, 0.5, "Austin", "TX", "78701"), error));
+    }
+
+    Query query;
+    CHECK(Query::parse("id>=A-1100 id<=A-1899 severity=4", store, query, error));
+    QueryPlan plan;
+    std::vector<RowId> rows = engine.execute(query, plan);
+    CHECK(plan.path == QueryPlan::INDEX_SCAN);
+    CHECK(rows.size() == 80);
+    for (RowId row : rows) {
+        std::string_view id = store.id(row);
+        CHECK(id >= "A-1100" && id <= "A-1899");
+        CHECK(store.severity(row) == 4);
+    }
+}
+
+// The city suggestions rank and count only the rows still in the table, a remove takes its row
+// out of the count of its city
+static void citySuggestionsCountLiveRows() {
+    RecordStore store;
+    HashTable hashTable(store);
+    RedBlackTree rbTree(store);
+    BPlusTree bPlusTree(store);
+    QueryEngine engine(store, hashTable, rbTree, bPlusTree);
+    std::string error;
+    //30 rows in San Diego and 20 in San Jose
+    for (int i = 0; i < 50; ++i) {
+        CHECK(engine.insert(TrafficAccident("A-" + std::to_string(1000 + i), 2, 0.5, i < 30 ? "San Diego" : "San Jose", "CA", "92101"), error));
+    }
+    for (int i = 0; i < 15; ++i) {
+        CHECK(engine.remove("A-" + std::to_string(1000 + i)));
+    }
+
+    std::vector<uint32_t> codes = store.cityNames().complete("san", 10, engine.cityRows());
+    CHECK(codes.size() == 2);
+    if (codes.size() == 2) {
+        CHECK(store.cities().value(codes[0]) == "San Jose" && engine.cityRows()[codes[0]] == 20);
+        CHECK(store.cities().value(codes[1]) == "San Diego" && engine.cityRows()[codes[1]] == 15);
+    }
+    for (int i = 15; i < 30; ++i) {
+        CHECK(engine.remove("A-" + std::to_string(1000 + i)));
+    }
+    CHECK(store.cityNames().complete("san", 10, engine.cityRows()).size() == 1);
+}
+
+// An ID longer than the B+ tree keys is refused by the engine with an error instead of being left
+// out of the B+ tree alone, so the B+ tree keeps every row and still answers ID ranges
+static void longIdIsRefused() {
+    RecordStore store;
+    HashTable hashTable(store);
+    RedBlackTree rbTree(store);
+    BPlusTree bPlusTree(store);
+    QueryEngine engine(store, hashTable, rbTree, bPlusTree);
+    std::string error;
+    for (int i = 0; i < 100; ++i) {
+        CHECK(engine.insert(TrafficAccident("A-" + std::to_string(1000 + i), 2, 0.5, "Austin", "TX", "78701"), error));
+    }
+    std::string longId(BPLUS_MAX_ID_LENGTH + 1, 'A');
+    CHECK(!engine.insert(TrafficAccident(longId, 2, 0.5, "Austin", "TX", "78701"), error));
+    CHECK(!error.empty());
+    CHECK(!bPlusTree.insert(longId, 2, 0.5, "Austin", "TX", "78701"));
+    CHECK(hashTable.getSize() == 100 && bPlusTree.getSize() == 100);
+
+    Query query;
+    CHECK(Query::parse("id>=A-1010 id<=A-1019", store, query, error));
+    QueryPlan plan;
+    std::vector<RowId> rows = engine.execute(query, plan);
+    CHECK(plan.path == QueryPlan::BPLUS_RANGE);
+    CHECK(rows.size() == 10);
+}
+
+int main() {
+    idRangeOnScanPath();
+    citySuggestionsCountLiveRows();
+    longIdIsRefused();
+    return failures == 0 ? 0 : 1;
+}